@@ -12,11 +12,12 @@ DynGenDef {
 	var prCurrentParams;
 
 	// private
-	classvar counter;
+	// keep batch messages and chunks well below the UDP packet size
+	classvar prMaxFilesPerMsg = 64;
+	classvar prChunkSize = 8192;
 
 	*initClass {
 		all = IdentityDictionary();
-		counter = 0;
 	}
 
 	*new {|name, code|
@@ -48,6 +49,58 @@ DynGenDef {
 		^this.new(name).load(path);
 	}
 
+	*sendDir {|path, server, completionMsg, extension|
+		var defs = [];
+		var files = PathName(path.standardizePath).files;
+		var servers = (server ?? { Server.allBootedServers }).asArray;
+		if(extension.notNil, {
+			files = files.select({|file| file.extension == extension.asString });
+		});
+		files.do({|file|
+			var def = this.load(file.fileNameWithoutExtension, file.fullPath);
+			defs = defs.add([def, file.fullPath]);
+		});
+		if(defs.isEmpty, {
+			"No DynGenDef files found in %.".format(path).warn;
+			// still perform the completion message, otherwise the caller might wait forever
+			completionMsg !? {
+				servers.do({|each| each.listSendMsg(completionMsg) });
+			};
+			^[];
+		});
+		servers.do({|each|
+			if(each.hasBooted.not, {
+				"Server % not running, could not send DynGenDefs.".format(each.name).warn
+			});
+			if(each.isLocal, {
+				// the server can read the files directly, so we register all of them
+				// with a single command per chunk, see prSendFilesMsg.
+				defs.clump(prMaxFilesPerMsg).do({|chunk, i|
+					var isLast = i == ((defs.size - 1) div: prMaxFilesPerMsg);
+					each.listSendMsg(DynGenDef.prSendFilesMsg(chunk, if(isLast, { completionMsg })));
+				});
+			}, {
+				defs.do({|pair, i|
+					pair[0].send(each, if(i == (defs.size - 1), { completionMsg }));
+				});
+			});
+		});
+		^defs.collect(_.first);
+	}
+
+	*prSendFilesMsg {|pairs, completionMsg|
+		var message = [
+			\cmd,
+			\dyngenfiles,
+			pairs.size,
+		];
+		pairs.do({|pair|
+			var def = pair[0];
+			message = message ++ [def.hash, pair[1], def.prParams.size] ++ def.prParams;
+		});
+		^message.add(completionMsg);
+	}
+
 	compile {|sample, init, block|
 		var output = "";
 		var transpilerInit;
@@ -116,9 +169,42 @@ DynGenDef {
 	}
 
 	sendMsg {|completionMsg|
+		^this.prScriptMsg(\dyngenscript, completionMsg);
+	}
+
+	prepare {|server, completionMsg|
+		var servers = (server ?? { Server.allBootedServers }).asArray;
+		servers.do { |each|
+			if(each.hasBooted.not) {
+				"Server % not running, could not prepare DynGenDef.".format(each.name).warn
+			};
+			each.listSendMsg(this.prepareMsg(completionMsg));
+		}
+	}
+
+	prepareMsg {|completionMsg|
+		^this.prScriptMsg(\dyngenprepare, completionMsg);
+	}
+
+	swap {|server, latency|
+		var servers = (server ?? { Server.allBootedServers }).asArray;
+		servers.do { |each|
+			each.listSendBundle(latency ?? { each.latency }, [this.swapMsg]);
+		}
+	}
+
+	swapMsg {
+		^[
+			\cmd,
+			\dyngenswap,
+			hash,
+		];
+	}
+
+	prScriptMsg {|command, completionMsg|
 		var message = [
 			\cmd,
-			\dyngenscript,
+			command,
 			hash,
 			code,
 			prParams.size,
@@ -167,6 +253,45 @@ DynGenDef {
 		];
 	}
 
+	*addLib {|name, code, server, completionMsg|
+		var servers = (server ?? { Server.allBootedServers }).asArray;
+		servers.do({|each|
+			if(each.hasBooted.not, {
+				"Server % not running, could not send DynGen library %.".format(each.name, name).warn;
+			});
+			each.listSendMsg(DynGenDef.addLibMsg(name, code, completionMsg));
+		});
+	}
+
+	*addLibMsg {|name, code, completionMsg|
+		^[
+			\cmd,
+			\dyngenlib,
+			name.asString,
+			code,
+			completionMsg,
+		];
+	}
+
+	*addWavetable {|buffer, server, completionMsg|
+		var servers = (server ?? { Server.allBootedServers }).asArray;
+		servers.do({|each|
+			if(each.hasBooted.not, {
+				"Server % not running, could not send DynGen wavetable %.".format(each.name, buffer).warn;
+			});
+			each.listSendMsg(DynGenDef.addWavetableMsg(buffer, completionMsg));
+		});
+	}
+
+	*addWavetableMsg {|buffer, completionMsg|
+		^[
+			\cmd,
+			\dyngenwavetable,
+			buffer.asControlInput,
+			completionMsg,
+		];
+	}
+
 	prMakeControls {
 		var allControls = [];
 		prCurrentParams.do({|param|
@@ -212,46 +337,38 @@ DynGenDef {
 		if(message.size < (65535 div: 4), {
 			server.sendRaw(message);
 		}, {
-			this.prSendFile(server, completionMsg);
+			this.prSendChunked(server, completionMsg);
 		});
 	}
 
-	prSendFile {|server, completionMsg|
-		var message;
-		var tmpFilePath = PathName.tmp +/+ "%_%".format(hash.asString, counter);
-		counter = counter + 1;
-
-		if (server.isLocal.not, {
-			"DynGenDef % could not be added  to server % because it is too big for sending via OSC and server is not local".format(
-				name,
-				server,
-			).warn;
-			^this;
+	// Uploads the script in several chunks which are assembled on the server.
+	// The server verifies the size and checksum before compiling the script.
+	prSendChunked {|server, completionMsg|
+		var commitMessage;
+		server.sendMsg(\cmd, \dyngenupload, hash, code.size, DynGenDef.prChecksum(code));
+		forBy(0, code.size - 1, prChunkSize, {|offset|
+			var chunk = code.copyRange(offset, min(offset + prChunkSize, code.size) - 1);
+			server.sendMsg(\cmd, \dyngenchunk, hash, offset, chunk);
 		});
-
-		File.use(tmpFilePath, "w", {|f|
-			f.write(code);
-		});
-
-		message = [
+		commitMessage = [
 			\cmd,
-			\dyngenfile,
+			\dyngencommit,
 			hash,
-			tmpFilePath,
 			prParams.size,
 		];
-		message = message ++ prParams;
-		message.add(completionMsg);
-		server.listSendMsg(message);
-
-		fork {
-			var deleteSuccess;
-			server.sync;
-			deleteSuccess = File.delete(tmpFilePath);
-			if (deleteSuccess.not, {
-				"Could not delete temp file % of DynGenDef %".format(tmpFilePath, name).warn;
-			});
-		}
+		commitMessage = commitMessage ++ prParams;
+		commitMessage = commitMessage.add(completionMsg);
+		server.listSendMsg(commitMessage);
+	}
+
+	// Adler-32 checksum of a String, see adler32() in string_utils.h
+	*prChecksum {|string|
+		var a = 1, b = 0;
+		string.do({|char|
+			a = (a + (char.ascii & 255)) % 65521;
+			b = (b + a) % 65521;
+		});
+		^(b << 16) | a;
 	}
 
 	*prHashSymbol {|symbol|
@@ -348,7 +465,7 @@ DynGen : MultiOutUGen {
 	}
 
 	init { |numOutputs, script, update, sync, pause, numInputs, numParams ... signals|
-		var audioInputs = signals[..(numInputs-1)];
+		var dynGenInputs = signals[..(numInputs-1)];
 		var params = signals[numInputs..];
 
 		params.pairsDo({|key, value|
@@ -364,15 +481,7 @@ DynGen : MultiOutUGen {
 		// update the parameter count because parameters might have been ignored!
 		numParams = params.size.div(2);
 
-		// signals must be audio rate
-		audioInputs = audioInputs.collect({|sig|
-			if(sig.rate != \audio, {
-				K2A.ar(sig);
-			}, {
-				sig;
-			});
-		});
-
+		// NOTE: control rate inputs are interpolated by the UGen itself, so we don't need K2A.
 		// inputs is a member variable of UGen
 		inputs = [
 			script.hash.asFloat,
@@ -381,7 +490,7 @@ DynGen : MultiOutUGen {
 			pause,
 			numInputs,
 			numParams,
-		] ++ audioInputs ++ params;
+		] ++ dynGenInputs ++ params;
 
 		^this.initOutputs(numOutputs, \audio);
 	}
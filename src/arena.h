@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+/*! @class Arena
+ *  @brief A simple bump allocator which hands out memory from a single heap allocation.
+ *
+ *  @discussion All memory is released at once when the arena is destroyed, so it
+ *  can only be used for trivially destructible types. The required capacity must
+ *  be known in advance, see Arena::sizeOf().
+ */
+class Arena {
+public:
+    /*! @brief returns the space needed for 'count' objects of type T */
+    template <typename T> static constexpr size_t sizeOf(size_t count) { return align(count * sizeof(T)); }
+
+    /*! @brief allocates the memory; must only be called once */
+    void reserve(size_t capacity) {
+        assert(!mData);
+        // NOTE: operator new[] returns memory which is aligned to alignof(std::max_align_t)
+        mData = std::make_unique<char[]>(capacity);
+        mCapacity = capacity;
+    }
+
+    /*! @brief returns an array of 'count' value-initialized objects */
+    template <typename T> T* alloc(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        static_assert(alignof(T) <= kAlignment);
+        auto size = sizeOf<T>(count);
+        assert(mSize + size <= mCapacity);
+        auto ptr = reinterpret_cast<T*>(mData.get() + mSize);
+        mSize += size;
+        for (size_t i = 0; i < count; ++i) {
+            new (ptr + i) T();
+        }
+        return ptr;
+    }
+
+private:
+    static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+    static constexpr size_t align(size_t size) { return (size + kAlignment - 1) & ~(kAlignment - 1); }
+
+    std::unique_ptr<char[]> mData;
+    size_t mCapacity = 0;
+    size_t mSize = 0;
+};
@@ -4,6 +4,8 @@
 
 #include "dyngen.h"
 
+#include <new>
+
 InterfaceTable* ft;
 
 DynGen::DynGen() {
@@ -22,6 +24,8 @@ DynGen::DynGen() {
     ClearUnitIfMemFailed(mStub);
     mStub->mObject = this;
     mStub->mRefCount = 1;
+    // the stub is allocated with RTAlloc(), so we have to construct the atomic ourselves
+    new (&mStub->mGeneration) std::atomic<uint32_t>(0);
 
     mParameterIndices = static_cast<int*>(RTAlloc(mWorld, sizeof(int) * mNumDynGenParameters));
     ClearUnitIfMemFailed(mParameterIndices);
@@ -54,6 +58,9 @@ DynGen::DynGen() {
             new EEL2Adapter(mNumDynGenInputs, mNumOutputs, static_cast<int>(sampleRate()), mBufLength, mWorld, this);
 
         if (vm->init(*mCodeLibrary->mScript, mParameterIndices, mNumDynGenParameters)) {
+            auto parameterValues = static_cast<float*>(alloca(sizeof(float) * mNumDynGenParameters));
+            getParameterValues(parameterValues);
+            vm->prepare(parameterValues);
             mVm = vm;
         } else {
             delete vm;
@@ -68,16 +75,74 @@ DynGen::DynGen() {
 
 void DynGen::next(int numSamples) {
     bool pause = in0(PauseIndex) != 0.f;
-    if (mVm == nullptr || pause) {
+    if (mSwapOffset >= 0) {
+        // the old vm runs until the scheduled sample offset
+        auto offset = std::min(mSwapOffset, numSamples);
+        mSwapOffset = -1;
+        processVm(mVm, 0, offset, pause);
+        swapPendingVm();
+        processVm(mVm, offset, numSamples - offset, pause);
+    } else {
+        processVm(mVm, 0, numSamples, pause);
+    }
+}
+
+void DynGen::processVm(EEL2Adapter* vm, int offset, int numSamples, bool pause) {
+    if (numSamples <= 0) {
+        return;
+    }
+    if (vm == nullptr || pause) {
         for (int i = 0; i < mNumOutputs; i++) {
-            Clear(numSamples, mOutBuf[i]);
+            Clear(numSamples, mOutBuf[i] + offset);
         }
+    } else if (offset == 0) {
+        vm->process(mInput + InputOffset, mOutBuf, mInput + InputOffset + mNumDynGenInputs, numSamples);
     } else {
-        mVm->process(mInBuf + InputOffset, mOutBuf, mInput + InputOffset + mNumDynGenInputs, numSamples);
+        // process the remaining part of the block with shifted audio rate inputs and outputs
+        auto numWires = mNumDynGenInputs + mNumDynGenParameters * 2;
+        auto wires = static_cast<Wire*>(alloca(numWires * sizeof(Wire)));
+        auto inputs = static_cast<Wire**>(alloca(numWires * sizeof(Wire*)));
+        for (int i = 0; i < numWires; i++) {
+            wires[i] = *mInput[InputOffset + i];
+            if (wires[i].mCalcRate == calc_FullRate) {
+                wires[i].mBuffer += offset;
+            }
+            inputs[i] = &wires[i];
+        }
+        auto outputs = static_cast<float**>(alloca(mNumOutputs * sizeof(float*)));
+        for (uint32 i = 0; i < mNumOutputs; i++) {
+            outputs[i] = mOutBuf[i] + offset;
+        }
+        vm->process(inputs, outputs, inputs + mNumDynGenInputs, numSamples);
+    }
+}
+
+void DynGen::scheduleSwap(int sampleOffset) {
+    if (mPendingVm) {
+        mSwapOffset = std::max(sampleOffset, 0);
+    } else if (mNumDeferredUpdates > 0) {
+        mSwapWhenReady = true;
     }
 }
 
-bool DynGen::updateCode(const DynGenScript* script) {
+void DynGen::swapPendingVm() {
+    if (mPendingVm) {
+        freeVm(mVm);
+        mVm = mPendingVm;
+        mPendingVm = nullptr;
+    }
+}
+
+void DynGen::freeVm(EEL2Adapter* vm) {
+    if (vm) {
+        // free the vm in RT context through async command
+        ft->fDoAsynchronousCommand(
+            mWorld, nullptr, nullptr, static_cast<void*>(vm), deleteVmOnSynthDestruction, nullptr, nullptr,
+            [](World*, void*) {}, 0, nullptr);
+    }
+}
+
+bool DynGen::updateCode(const DynGenScript* script, bool deferSwap) {
     // If we already have a VM, our code is being updated.
     // In this case, the input at UpdateIndex controls the update behavior.
     if (mVm != nullptr) {
@@ -87,13 +152,14 @@ bool DynGen::updateCode(const DynGenScript* script) {
         }
     }
 
-    // allocate extra space for parameter indices, see DynGenCallbackData.
-    auto payloadSize = sizeof(DynGenCallbackData) + sizeof(int) * mNumDynGenParameters;
+    // allocate extra space for parameter indices and values, see DynGenCallbackData.
+    auto payloadSize = sizeof(DynGenCallbackData) + (sizeof(int) + sizeof(float)) * mNumDynGenParameters;
     auto payload = static_cast<DynGenCallbackData*>(RTAlloc(mWorld, payloadSize));
 
     // guard in case allocation fails
     if (payload) {
         payload->dynGenStub = mStub;
+        payload->generation = mStub->mGeneration.fetch_add(1) + 1;
         payload->numInputChannels = mNumDynGenInputs;
         payload->numOutputChannels = mNumOutputs;
         payload->numParameters = mNumDynGenParameters;
@@ -103,10 +169,16 @@ bool DynGen::updateCode(const DynGenScript* script) {
         payload->unit = this;
         payload->oldVm = nullptr;
         payload->script = script;
+        payload->deferSwap = deferSwap;
+        if (deferSwap) {
+            mNumDeferredUpdates++;
+        }
 
         for (int i = 0; i < mNumDynGenParameters; ++i) {
             payload->parameterIndices[i] = mParameterIndices[i];
         }
+        // the @prepare section sees the parameter values at the time of the update
+        getParameterValues(payload->parameterValues());
 
         // increment ref counter before we start the async command
         mStub->mRefCount += 1;
@@ -118,6 +190,13 @@ bool DynGen::updateCode(const DynGenScript* script) {
     return payload != nullptr;
 }
 
+void DynGen::getParameterValues(float* values) const {
+    for (int i = 0; i < mNumDynGenParameters; i++) {
+        // parameters come in index-value pairs, so only take each 2nd position
+        values[i] = in0(InputOffset + mNumDynGenInputs + (2 * i) + 1);
+    }
+}
+
 DynGen::~DynGen() {
     RTFree(mWorld, mParameterIndices);
 
@@ -136,16 +215,20 @@ DynGen::~DynGen() {
         }
     }
 
-    if (mVm) {
-        // free the vm in RT context through async command
-        ft->fDoAsynchronousCommand(
-            mWorld, nullptr, nullptr, static_cast<void*>(mVm), deleteVmOnSynthDestruction, nullptr, nullptr,
-            [](World*, void*) {}, 0, nullptr);
-    }
+    freeVm(mVm);
+    freeVm(mPendingVm);
 }
 
 bool DynGen::createVmAndCompile(World* world, void* rawCallbackData) {
     auto callbackData = static_cast<DynGenCallbackData*>(rawCallbackData);
+    auto isOutdated = [callbackData]() {
+        return callbackData->generation != callbackData->dynGenStub->mGeneration.load(std::memory_order_relaxed);
+    };
+
+    // skip if there is already a newer update in the queue
+    if (isOutdated()) {
+        return false;
+    }
 
     callbackData->vm =
         new EEL2Adapter(callbackData->numInputChannels, callbackData->numOutputChannels, callbackData->sampleRate,
@@ -159,6 +242,13 @@ bool DynGen::createVmAndCompile(World* world, void* rawCallbackData) {
         delete callbackData->vm;
         return false;
     }
+    // run the @prepare section here so that it doesn't block the audio thread
+    callbackData->vm->prepare(callbackData->parameterValues());
+    // a newer update might have arrived in the meantime
+    if (isOutdated()) {
+        delete callbackData->vm;
+        return false;
+    }
     // continue with stage 3
     return true;
 }
@@ -166,9 +256,19 @@ bool DynGen::createVmAndCompile(World* world, void* rawCallbackData) {
 bool DynGen::swapVmPointers(World* world, void* rawCallbackData) {
     auto callbackData = static_cast<DynGenCallbackData*>(rawCallbackData);
     // only replace if DynGen instance is still existing
-    if (callbackData->dynGenStub->mObject) {
-        callbackData->oldVm = callbackData->dynGenStub->mObject->mVm;
-        callbackData->dynGenStub->mObject->mVm = callbackData->vm;
+    if (auto dynGen = callbackData->dynGenStub->mObject) {
+        if (callbackData->deferSwap) {
+            // keep the new vm until it is swapped in, see scheduleSwap()
+            callbackData->oldVm = dynGen->mPendingVm;
+            dynGen->mPendingVm = callbackData->vm;
+            if (dynGen->mSwapWhenReady) {
+                dynGen->mSwapWhenReady = false;
+                dynGen->mSwapOffset = 0;
+            }
+        } else {
+            callbackData->oldVm = dynGen->mVm;
+            dynGen->mVm = callbackData->vm;
+        }
     } else {
         // mark the vm we just created ready for deletion since the DynGen
         // it was created for does not exist anymore.
@@ -185,6 +285,12 @@ bool DynGen::deleteOldVm(World* world, void* rawCallbackData) {
 
 void DynGen::dynGenInitCallbackCleanup(World* world, void* rawCallbackData) {
     auto callback = static_cast<DynGenCallbackData*>(rawCallbackData);
+    if (auto dynGen = callback->dynGenStub->mObject; dynGen && callback->deferSwap) {
+        // NOTE: do this here because the update might have failed or been dropped
+        if (--dynGen->mNumDeferredUpdates == 0) {
+            dynGen->mSwapWhenReady = false;
+        }
+    }
     callback->dynGenStub->mRefCount -= 1;
     // destroy if there are no references to the DynGen
     if (callback->dynGenStub->mRefCount == 0) {
@@ -193,6 +299,51 @@ void DynGen::dynGenInitCallbackCleanup(World* world, void* rawCallbackData) {
     RTFree(world, callback);
 }
 
+void DynGen::setVarCmd(Unit* unit, sc_msg_iter* args) {
+    auto dynGen = static_cast<DynGen*>(unit);
+    if (!dynGen->mVm) {
+        Print("ERROR: DynGen setVar: script is not running\n");
+        return;
+    }
+    while (args->remain() > 0) {
+        const char* name = args->gets();
+        if (!name) {
+            Print("ERROR: DynGen setVar: expected variable name\n");
+            return;
+        }
+        auto value = args->getd();
+        if (!dynGen->mVm->setVariable(name, value)) {
+            Print("ERROR: DynGen setVar: unknown variable '%s'\n", name);
+        }
+    }
+}
+
+void DynGen::setMemCmd(Unit* unit, sc_msg_iter* args) {
+    auto dynGen = static_cast<DynGen*>(unit);
+    if (!dynGen->mVm) {
+        Print("ERROR: DynGen setMem: script is not running\n");
+        return;
+    }
+    auto offset = args->geti(-1);
+    if (offset < 0) {
+        Print("ERROR: DynGen setMem: invalid offset\n");
+        return;
+    }
+    while (args->remain() > 0) {
+        // the memory is split into several blocks, so we have to write chunk by chunk.
+        int numValid = 0;
+        double* mem = dynGen->mVm->getMemory(offset, numValid);
+        if (!mem || numValid <= 0) {
+            Print("ERROR: DynGen setMem: offset %d out of range\n", offset);
+            return;
+        }
+        for (int i = 0; i < numValid && args->remain() > 0; ++i) {
+            mem[i] = args->getd();
+        }
+        offset += numValid;
+    }
+}
+
 bool DynGen::deleteVmOnSynthDestruction(World* world, void* rawCallbackData) {
     const auto vm = static_cast<EEL2Adapter*>(rawCallbackData);
     delete vm;
@@ -215,10 +366,25 @@ PluginLoad("DynGen") {
     // 'out*' variables potentially aliasing 'in*' variables.
     registerUnit<DynGen>(inTable, "DynGen", true);
 
+    DefineUnitCmd("DynGen", "setVar", DynGen::setVarCmd);
+    DefineUnitCmd("DynGen", "setMem", DynGen::setMemCmd);
+
     ft->fDefinePlugInCmd("dyngenfile", Library::dyngenAddFileCallback, nullptr);
 
     ft->fDefinePlugInCmd("dyngenscript", Library::addScriptCallback, nullptr);
 
+    ft->fDefinePlugInCmd("dyngenprepare", Library::prepareScriptCallback, nullptr);
+    ft->fDefinePlugInCmd("dyngenswap", Library::swapScriptCallback, nullptr);
+
+    ft->fDefinePlugInCmd("dyngenfiles", Library::addFilesCallback, nullptr);
+
+    ft->fDefinePlugInCmd("dyngenupload", Library::beginUploadCallback, nullptr);
+    ft->fDefinePlugInCmd("dyngenchunk", Library::uploadChunkCallback, nullptr);
+    ft->fDefinePlugInCmd("dyngencommit", Library::commitUploadCallback, nullptr);
+
+    ft->fDefinePlugInCmd("dyngenlib", Library::addFunctionLibraryCallback, nullptr);
+    ft->fDefinePlugInCmd("dyngenwavetable", Library::addWavetableCallback, nullptr);
+
     ft->fDefinePlugInCmd("dyngenfree", Library::freeScriptCallback, nullptr);
     ft->fDefinePlugInCmd("dyngenfreeall", Library::freeAllScriptsCallback, nullptr);
 }
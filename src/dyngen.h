@@ -16,14 +16,28 @@ public:
     ~DynGen();
 
     /*! @brief updates vm in an async manner.
+     *  If 'deferSwap' is true, the new vm is only prepared, see scheduleSwap().
      *  Returns false in case the allocation of the callback data failed.
      */
-    bool updateCode(const DynGenScript* script);
+    bool updateCode(const DynGenScript* script, bool deferSwap = false);
+
+    /*! @brief swaps in the prepared vm at the given sample offset of the next block.
+     *  If the vm is not ready yet, it will be swapped in as soon as it arrives.
+     */
+    void scheduleSwap(int sampleOffset);
 
     /*! @brief the active vm - at the point it is not a null pointer it will
      *  be consumed. Owned by NRT thread.
      */
     EEL2Adapter* mVm = nullptr;
+    /*! @brief the vm which has been prepared by a deferred update, see scheduleSwap() */
+    EEL2Adapter* mPendingVm = nullptr;
+    /*! @brief the number of deferred updates that are still in flight */
+    int mNumDeferredUpdates = 0;
+    /*! @brief the sample offset at which the pending vm should be swapped in, or -1 */
+    int mSwapOffset = -1;
+    /*! @brief swap in the pending vm as soon as it arrives */
+    bool mSwapWhenReady = false;
     /*! @brief since a DynGen is linked to a single code instance it
      *  is sufficient to link all DynGen instances with the same
      *  code internally
@@ -37,6 +51,18 @@ public:
 
     DynGenStub* mStub = nullptr;
 
+    /*! @brief unit command to set one or more variables of the running script:
+     *  /u_cmd nodeID unitIndex setVar name1 value1 [name2 value2 ...]
+     *  Unit commands are executed on the RT thread between blocks, so the new values
+     *  are seen by the next block.
+     */
+    static void setVarCmd(Unit* unit, sc_msg_iter* args);
+
+    /*! @brief unit command to write a block of values into the memory of the running script:
+     *  /u_cmd nodeID unitIndex setMem offset value1 [value2 ...]
+     */
+    static void setMemCmd(Unit* unit, sc_msg_iter* args);
+
 private:
     enum {
         CodeIDIndex = 0,
@@ -54,6 +80,18 @@ private:
 
     void next(int numSamples);
 
+    /*! @brief runs the given vm for a part of the block, or clears the outputs if there is no vm */
+    void processVm(EEL2Adapter* vm, int offset, int numSamples, bool pause);
+
+    /*! @brief replaces the active vm with the pending vm, see scheduleSwap() */
+    void swapPendingVm();
+
+    /*! @brief delete a vm on the NRT thread */
+    void freeVm(EEL2Adapter* vm);
+
+    /*! @brief get the current values of all parameter inputs */
+    void getParameterValues(float* values) const;
+
     /*! @brief ~DynGen callback to destroy the vm in a NRT thread on stage 2 */
     static bool deleteVmOnSynthDestruction(World* world, void* rawCallbackData);
 
@@ -6,6 +6,7 @@
 #include "dyngen_script.h"
 #include "string_utils.h"
 
+#include <algorithm>
 #include <cassert>
 #include <charconv>
 #include <sstream>
@@ -21,6 +22,10 @@ std::optional<ParamType> getParamTypeFromString(std::string_view string) {
         return ParamType::Trigger;
     } else if (string == "const") {
         return ParamType::Const;
+    } else if (string == "exp") {
+        return ParamType::Exponential;
+    } else if (string == "lag") {
+        return ParamType::Lag;
     } else {
         return std::nullopt;
     }
@@ -36,6 +41,10 @@ const char* paramTypeString(ParamType type) {
         return "trig";
     case ParamType::Const:
         return "const";
+    case ParamType::Exponential:
+        return "exp";
+    case ParamType::Lag:
+        return "lag";
     }
     assert(false);
     return "?";
@@ -90,12 +99,24 @@ void parseType(ParamSpec& spec, std::string_view value) {
     }
 }
 
+void parseLagTime(ParamSpec& spec, std::string_view value) {
+    if (auto number = parseDouble(value); number && *number >= 0.0) {
+        spec.lagTime = *number;
+        // implies "lag" type
+        spec.type = ParamType::Lag;
+    } else {
+        std::stringstream stream;
+        stream << "parameter '" << spec.name << "': bad lag time '" << value << "'";
+        throw std::runtime_error(stream.str());
+    }
+}
+
 /*! @brief try to parse a line as a parameter declaration.
  *  'line' must contain non-whitespace characters and must not be a comment.
  *  Throws an exception on failure (e.g. syntax error)
  *
  *  Syntax:
- *  <name>: [init=]<init>, [type=]<type>
+ *  <name>: [init=]<init>, [type=]<type>, [lag=<seconds>]
  *
  *  More properties might be added in the future, e.g. <min>, <max>, <warp>, <step>, <unit>, etc.
  *  For example, these could be used by Clients for GUI representations (e.g. ControlSpec in SC)
@@ -152,6 +173,8 @@ ParamSpec parseParameterSpec(std::string_view line) {
                     parseInitValue(spec, value);
                 } else if (key == "type") {
                     parseType(spec, value);
+                } else if (key == "lag") {
+                    parseLagTime(spec, value);
                 } else {
                     std::stringstream stream;
                     stream << "parameter '" << spec.name << "': unknown key '" << key << "'";
@@ -185,6 +208,108 @@ ParamSpec parseParameterSpec(std::string_view line) {
     return spec;
 }
 
+/*! @brief check if the given string is a valid EEL2 variable name */
+bool isVariableName(std::string_view string) {
+    if (string.empty() || (string[0] >= '0' && string[0] <= '9')) {
+        return false;
+    }
+    return std::all_of(string.begin(), string.end(), [](char c) { return isAlphaNumeric(c) || c == '_' || c == '.'; });
+}
+
+std::optional<int> parseInt(std::string_view string) {
+    int value;
+    auto [ptr, err] = std::from_chars(string.data(), string.data() + string.size(), value);
+    if (err == std::errc {} && ptr == string.data() + string.size()) {
+        return value;
+    } else {
+        return std::nullopt;
+    }
+}
+
+/*! @brief try to parse a line as a tap declaration.
+ *  Throws an exception on failure (e.g. syntax error)
+ *
+ *  Syntax:
+ *  <buffer>: <target>[, <target>...][, rate=<sample|block>][, pos=<variable>]
+ *
+ *  <buffer> is either a buffer number or a variable name, e.g. a parameter.
+ *  <target> is either a variable name or an absolute memory range [<start>:<count>].
+ */
+TapSpec parseTapSpec(std::string_view line) {
+    TapSpec spec;
+
+    line = trim(line);
+    auto bufferEndPos = line.find(':');
+    if (bufferEndPos == std::string_view::npos) {
+        throw std::runtime_error("@tap: missing buffer");
+    }
+    auto buffer = trim(line.substr(0, bufferEndPos));
+    if (auto bufNum = parseInt(buffer)) {
+        if (*bufNum < 0) {
+            throw std::runtime_error("@tap: negative buffer number '" + std::string(buffer) + "'");
+        }
+        spec.bufNum = *bufNum;
+    } else if (!isVariableName(buffer)) {
+        throw std::runtime_error("@tap: bad buffer '" + std::string(buffer) + "'");
+    }
+    spec.buffer = buffer;
+
+    forEachLine(
+        line.substr(bufferEndPos + 1),
+        [&](std::string_view arg, size_t) {
+            arg = trim(arg);
+            if (arg.empty()) {
+                // ignore trailing commas
+                return;
+            }
+            if (auto eqPos = arg.find('='); eqPos != std::string_view::npos) {
+                // keyword argument
+                auto key = trim(arg.substr(0, eqPos));
+                auto value = trim(arg.substr(eqPos + 1));
+                if (key == "rate") {
+                    if (value == "sample") {
+                        spec.rate = TapRate::Sample;
+                    } else if (value == "block") {
+                        spec.rate = TapRate::Block;
+                    } else {
+                        throw std::runtime_error("@tap: bad rate '" + std::string(value) + "'");
+                    }
+                } else if (key == "pos") {
+                    if (!isVariableName(value)) {
+                        throw std::runtime_error("@tap: bad position variable '" + std::string(value) + "'");
+                    }
+                    spec.position = value;
+                } else {
+                    throw std::runtime_error("@tap: unknown key '" + std::string(key) + "'");
+                }
+            } else if (arg.front() == '[' && arg.back() == ']') {
+                // memory range
+                auto range = arg.substr(1, arg.size() - 2);
+                auto sepPos = range.find(':');
+                std::optional<int> start, count;
+                if (sepPos != std::string_view::npos) {
+                    start = parseInt(trim(range.substr(0, sepPos)));
+                    count = parseInt(trim(range.substr(sepPos + 1)));
+                }
+                if (!start || !count || *start < 0 || *count <= 0) {
+                    throw std::runtime_error("@tap: bad memory range '" + std::string(arg) + "'");
+                }
+                spec.targets.push_back({ "", *start, *count });
+            } else if (isVariableName(arg)) {
+                spec.targets.push_back({ std::string(arg) });
+            } else {
+                throw std::runtime_error("@tap: bad target '" + std::string(arg) + "'");
+            }
+        },
+        ',');
+
+    if (spec.targets.empty()) {
+        throw std::runtime_error("@tap: no variables or memory ranges");
+    }
+
+    return spec;
+}
+
 /*! @brief try to find a code directive (@<name>) in the given line.
  *  The name must either extend to the end of the line or be followed by at least one whitespace character.
  *  The function returns a CodeDirective followed by the index just past the directive string.
@@ -204,12 +329,26 @@ std::pair<CodeDirective, size_t> findCodeDirective(std::string_view line) {
             size_t end;
             if (matchName("@init", pos, end)) {
                 return { CodeDirective::Init, end };
+            } else if (matchName("@static", pos, end)) {
+                return { CodeDirective::Static, end };
+            } else if (matchName("@prepare", pos, end)) {
+                return { CodeDirective::Prepare, end };
             } else if (matchName("@block", pos, end)) {
                 return { CodeDirective::Block, end };
             } else if (matchName("@sample", pos, end)) {
                 return { CodeDirective::Sample, end };
             } else if (matchName("@param", pos, end)) {
                 return { CodeDirective::Param, end };
+            } else if (matchName("@tap", pos, end)) {
+                return { CodeDirective::Tap, end };
+            } else if (matchName("@optimize", pos, end)) {
+                return { CodeDirective::Optimize, end };
+            } else if (matchName("@import", pos, end)) {
+                return { CodeDirective::Import, end };
+            } else if (matchName("@lanes", pos, end)) {
+                return { CodeDirective::Lanes, end };
+            } else if (matchName("@oversample", pos, end)) {
+                return { CodeDirective::Oversample, end };
             } else {
                 // just return the end of line
                 return { CodeDirective::Unknown, line.size() };
@@ -223,6 +362,14 @@ std::pair<CodeDirective, size_t> findCodeDirective(std::string_view line) {
 
 } // namespace
 
+//-------------------- DynGenStaticData -------------------//
+
+DynGenStaticData::~DynGenStaticData() {
+    if (mMemory) {
+        NSEEL_VM_FreeGRAM(&mMemory);
+    }
+}
+
 //-------------------- DynGenScript -------------------//
 
 bool DynGenScript::parse(std::string_view script, char** paramNames, int numParams) {
@@ -231,6 +378,8 @@ bool DynGenScript::parse(std::string_view script, char** paramNames, int numPara
         return false;
     }
 
+    std::string_view staticCode;
+    std::string_view prepareCode;
     std::string_view initCode;
     std::string_view blockCode;
     std::string_view sampleCode;
@@ -239,8 +388,20 @@ bool DynGenScript::parse(std::string_view script, char** paramNames, int numPara
     CodeSection currentSection = CodeSection::None;
     size_t currentSectionStart = 0;
 
-    auto closeSection = [&initCode, &blockCode, &sampleCode](CodeSection section, std::string_view code) {
-        if (section == CodeSection::Init) {
+    auto closeSection = [&](CodeSection section, std::string_view code) {
+        if (section == CodeSection::Static) {
+            if (staticCode.empty()) {
+                staticCode = code;
+            } else {
+                throw std::runtime_error("duplicate @static section");
+            }
+        } else if (section == CodeSection::Prepare) {
+            if (prepareCode.empty()) {
+                prepareCode = code;
+            } else {
+                throw std::runtime_error("duplicate @prepare section");
+            }
+        } else if (section == CodeSection::Init) {
             if (initCode.empty()) {
                 initCode = code;
             } else {
@@ -276,7 +437,11 @@ bool DynGenScript::parse(std::string_view script, char** paramNames, int numPara
     try {
         forEachLine(script, [&](std::string_view line, size_t linePos) {
             auto [directive, endPos] = findCodeDirective(line);
-            if (directive == CodeDirective::Init) {
+            if (directive == CodeDirective::Static) {
+                startNewSection(CodeSection::Static, linePos, line.size());
+            } else if (directive == CodeDirective::Prepare) {
+                startNewSection(CodeSection::Prepare, linePos, line.size());
+            } else if (directive == CodeDirective::Init) {
                 startNewSection(CodeSection::Init, linePos, line.size());
             } else if (directive == CodeDirective::Block) {
                 startNewSection(CodeSection::Block, linePos, line.size());
@@ -293,6 +458,44 @@ bool DynGenScript::parse(std::string_view script, char** paramNames, int numPara
                               spec.initValue, paramTypeString(spec.type), spec.minValue, spec.maxValue);
 #endif
                         paramSpecs.push_back(std::move(spec));
+                    } else if (directive == CodeDirective::Tap) {
+                        // throws on error!
+                        mTaps.push_back(parseTapSpec(line.substr(endPos)));
+                    } else if (directive == CodeDirective::Optimize) {
+                        mOptimize = true;
+                    } else if (directive == CodeDirective::Import) {
+                        auto name = trim(line.substr(endPos));
+                        auto library = Library::findFunctionLibrary(name);
+                        if (!library) {
+                            throw std::runtime_error("@import: unknown function library '" + std::string(name) + "'");
+                        }
+                        // each library only needs to be imported once
+                        if (std::find(mImports.begin(), mImports.end(), library) == mImports.end()) {
+                            mImports.push_back(std::move(library));
+                        }
+                    } else if (directive == CodeDirective::Lanes) {
+                        // syntax: @lanes <count> [sum]
+                        auto args = trim(line.substr(endPos));
+                        auto sepPos = args.find_first_of(" \t");
+                        auto count = parseInt(args.substr(0, sepPos));
+                        auto mode = sepPos != std::string_view::npos ? trim(args.substr(sepPos)) : "";
+                        if (!count || *count < 1) {
+                            throw std::runtime_error("@lanes: bad lane count '" + std::string(args) + "'");
+                        }
+                        if (!mode.empty() && mode != "sum") {
+                            throw std::runtime_error("@lanes: unknown mode '" + std::string(mode) + "'");
+                        }
+                        mNumLanes = *count;
+                        mSumLanes = mode == "sum";
+                    } else if (directive == CodeDirective::Oversample) {
+                        // syntax: @oversample <factor>
+                        auto args = trim(line.substr(endPos));
+                        auto factor = parseInt(args);
+                        if (!factor || (*factor != 1 && *factor != 2 && *factor != 4 && *factor != 8)) {
+                            throw std::runtime_error("@oversample: bad factor '" + std::string(args)
+                                                     + "' (must be 1, 2, 4 or 8)");
+                        }
+                        mOversample = *factor;
                     } else if (directive == CodeDirective::Unknown) {
                         // just skip unknown directive.
                     }
@@ -324,6 +527,10 @@ bool DynGenScript::parse(std::string_view script, char** paramNames, int numPara
     }
 
     // do not compile and evaluate empty sections.
+    if (!isWhitespace(staticCode))
+        mStatic = staticCode;
+    if (!isWhitespace(prepareCode))
+        mPrepare = prepareCode;
     if (!isWhitespace(initCode))
         mInit = initCode;
     if (!isWhitespace(blockCode))
@@ -335,6 +542,14 @@ bool DynGenScript::parse(std::string_view script, char** paramNames, int numPara
 
 #if DEBUG_CODE_SECTIONS
     Print("Code sections:\n");
+    if (!mStatic.empty()) {
+        Print("--- @static ---\n");
+        Print("%s\n", mStatic.c_str());
+    }
+    if (!mPrepare.empty()) {
+        Print("--- @prepare ---\n");
+        Print("%s\n", mPrepare.c_str());
+    }
     if (!mInit.empty()) {
         Print("--- @init ---\n");
         Print("%s\n", mInit.c_str());
@@ -358,6 +573,20 @@ bool DynGenScript::tryCompile() {
     return state.init(*this, nullptr, 0);
 }
 
+bool DynGenScript::initStatic(World* world) {
+    if (mStatic.empty()) {
+        return true;
+    }
+
+    auto data = std::make_shared<DynGenStaticData>();
+    if (!EEL2Adapter::evalStatic(*this, *data, world)) {
+        return false;
+    }
+    mStaticData = std::move(data);
+
+    return true;
+}
+
 /*! @brief add the given parameter names to the DynGen script. */
 void DynGenScript::addParameters(const std::vector<ParamSpec>& specs, char** paramNames, int numParams) {
 #if DEBUG_SCRIPT_PARAMS
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "library.h"
+
 #include <limits>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #ifndef DEBUG_CODE_SECTIONS
@@ -17,9 +21,23 @@
 #    define DEBUG_SCRIPT_PARAMS 0
 #endif
 
-enum class CodeDirective { None, Param, Init, Block, Sample, Unknown };
+enum class CodeDirective {
+    None,
+    Param,
+    Tap,
+    Optimize,
+    Import,
+    Lanes,
+    Oversample,
+    Static,
+    Prepare,
+    Init,
+    Block,
+    Sample,
+    Unknown
+};
 
-enum class CodeSection { None, Init, Block, Sample };
+enum class CodeSection { None, Static, Prepare, Init, Block, Sample };
 
 /*! @brief The different parameter types */
 enum class ParamType {
@@ -39,7 +57,16 @@ enum class ParamType {
     /*! The parameter is read only once at the very beginning and is guaranteed
      *  not to change after that.
      */
-    Const
+    Const,
+    /*! Like Linear, but control-rate inputs are interpolated exponentially, i.e. with a
+     *  constant ratio between samples. This is useful for frequencies and amplitudes.
+     *  Falls back to linear interpolation if the old and new value differ in sign or are zero.
+     */
+    Exponential,
+    /*! The parameter is smoothed with a one-pole lowpass filter, just like the Lag UGen.
+     *  The lag time is set with the 'lag' key, see ParamSpec::lagTime.
+     */
+    Lag
 };
 
 std::optional<ParamType> getParamTypeFromString(std::string_view sv);
@@ -50,6 +77,51 @@ struct ParamSpec {
     std::string name;
     ParamType type = ParamType::Linear;
     double initValue = 0.0;
+    /*! @brief the 60 dB lag time in seconds for ParamType::Lag */
+    double lagTime = 0.1;
+};
+
+/*! @brief How often a tap writes a frame into its buffer */
+enum class TapRate { Sample, Block };
+
+/*! @brief A tap declared with the @tap directive.
+ *  After the script has been executed, DynGen writes the values of the tapped
+ *  variables and memory ranges as a single frame into a ring buffer (SndBuf).
+ */
+struct TapSpec {
+    /*! @brief a single variable or an absolute memory range */
+    struct Target {
+        /*! @brief the variable name; empty for memory ranges */
+        std::string variable;
+        int memStart = 0;
+        int memCount = 1;
+    };
+
+    /*! @brief the buffer number, either a number or the name of a variable (e.g. a parameter) */
+    std::string buffer;
+    /*! @brief the parsed buffer number, or -1 if 'buffer' is a variable name */
+    int bufNum = -1;
+    std::vector<Target> targets;
+    TapRate rate = TapRate::Sample;
+    /*! @brief optional variable which receives the current write position */
+    std::string position;
+};
+
+/*! @brief The result of evaluating the @static section of a script.
+ *  It is shared by the script and all VMs created from it, so it stays
+ *  alive as long as any VM still uses it - even if the script itself has
+ *  already been replaced. NRT managed and read-only after creation.
+ */
+struct DynGenStaticData {
+    DynGenStaticData() = default;
+    DynGenStaticData(const DynGenStaticData&) = delete;
+    DynGenStaticData& operator=(const DynGenStaticData&) = delete;
+    ~DynGenStaticData();
+
+    /*! @brief the EEL2 global memory (gmem) written by the @static section */
+    void* mMemory = nullptr;
+    /*! @brief all variables defined by the @static section and their values */
+    std::vector<std::pair<std::string, double>> mVariables;
 };
 
 /*! @class DynGenScript
@@ -64,9 +136,14 @@ public:
     /*! @brief Try to compile the code sections; print error on failure.
      *  non rt safe! */
     bool tryCompile();
+    /*! @brief Evaluate the @static section (if any) and store the result so it
+     *  can be shared by all instances. non rt safe! */
+    bool initStatic(World* world);
 
     void setupParameters();
 
+    std::string mStatic;
+    std::string mPrepare;
     std::string mInit;
     std::string mBlock;
     std::string mSample;
@@ -76,6 +153,31 @@ public:
      */
     std::vector<ParamSpec> mParameters;
 
+    /*! @brief the taps declared with the @tap directive */
+    std::vector<TapSpec> mTaps;
+
+    /*! @brief set by the @optimize directive, see ConstantInliner */
+    bool mOptimize = false;
+
+    /*! @brief the function libraries imported with the @import directive, in order */
+    std::vector<std::shared_ptr<const DynGenFunctionLibrary>> mImports;
+
+    /*! @brief number of independent lanes, set by the @lanes directive.
+     *  Every lane has its own variables and inputs, but all lanes share the same
+     *  compiled code and memory.
+     */
+    int mNumLanes = 1;
+    /*! @brief if true, the outputs of all lanes are summed, otherwise every lane has its own outputs */
+    bool mSumLanes = false;
+
+    /*! @brief the oversampling factor (1, 2, 4 or 8), set by the @oversample directive.
+     *  The script runs at the higher sample rate, see Oversampler.
+     */
+    int mOversample = 1;
+
+    /*! @brief the evaluated @static section; NULL if the script does not have one */
+    std::shared_ptr<DynGenStaticData> mStaticData;
+
 private:
     void addParameters(const std::vector<ParamSpec>& specs, char** paramNames, int numParams);
 };
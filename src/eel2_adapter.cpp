@@ -1,6 +1,12 @@
 #define WDL_FFT_REALSIZE 8
 
 #include "eel2_adapter.h"
+#include "fast_math.h"
+#include "filters.h"
+#include "matrix_ops.h"
+#include "script_optimizer.h"
+#include "spin_lock.h"
+#include "vector_ops.h"
 
 #include "ns-eel-addfuncs.h"
 #include "ns-eel-int.h"
@@ -15,38 +21,23 @@
 #include <atomic>
 #include <cassert>
 #include <charconv>
-
-// The following is copied from SC_SndBuf.h
-#if defined(_MSC_VER) // Visual Studio Intel/ARM64
-static void pauseCpu() { YieldProcessor(); }
-#elif defined(__SSE2__) // all modern Intel processors
-#    include <immintrin.h>
-static void pauseCpu() { _mm_pause(); }
-#elif defined(__aarch64__) // 64-bit ARM
-static void pauseCpu() { __asm__ __volatile__("isb"); }
-#elif defined(__arm__) // 32-bit ARM
-static void pauseCpu() { __asm__ __volatile__("yield"); }
-#else
-#    warning "unknown architecture: fall back to busy-waiting"
-static void pauseCpu() {}
-#endif
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <limits>
 
 // Some EEL functions internally use global state that must be protected from
 // concurrent access! Even without Supernova we call into EEL2 from different
 // threads (the RT and the NRT thread), so we better play it safe and implement
 // NSEEL_HOSTSTUB_EnterMutex() and NSEEL_HOSTSTUB_LeaveMutex().
-static std::atomic<uint32_t> g_spinlock { 0 };
-
-extern "C" void NSEEL_HOSTSTUB_EnterMutex() {
-    // optimize for non-contended case
-    while (g_spinlock.exchange(1, std::memory_order_acquire) != 0) {
-        while (g_spinlock.load(std::memory_order_relaxed) != 0)
-            pauseCpu();
-    }
-}
+// NOTE: on the audio thread(s), the lock is only taken when the script allocates
+// new blocks of the (shared) global memory, i.e. 'gmem'. Everything else in the
+// DSP path is per instance, so DynGen instances can safely run in parallel.
+static SpinLock gEelLock;
 
-extern "C" void NSEEL_HOSTSTUB_LeaveMutex() { g_spinlock.store(0, std::memory_order_release); }
+extern "C" void NSEEL_HOSTSTUB_EnterMutex() { gEelLock.lock(); }
 
+extern "C" void NSEEL_HOSTSTUB_LeaveMutex() { gEelLock.unlock(); }
 
 void EEL2Adapter::setup() {
     EEL_fft_register();
@@ -60,6 +51,7 @@ void EEL2Adapter::setup() {
     NSEEL_addfunc_retval("bufSampleRate", 1, NSEEL_PProc_THIS, &eelBufSampleRate);
     NSEEL_addfunc_retval("bufChannels", 1, NSEEL_PProc_THIS, &eelBufChannels);
     NSEEL_addfunc_retval("bufFrames", 1, NSEEL_PProc_THIS, &eelBufFrames);
+    NSEEL_addfunc_retval("wavetable", 3, NSEEL_PProc_THIS, &eelWavetable);
 
     // done actions
     NSEEL_addfunc_retval("setDone", 1, NSEEL_PProc_THIS, &eelSetDone);
@@ -73,11 +65,59 @@ void EEL2Adapter::setup() {
     NSEEL_addfunc_retval("lin", 3, NSEEL_PProc_THIS, &eelLininterp);
     NSEEL_addfunc_varparm("cubic", 5, NSEEL_PProc_THIS, &eelCubicinterp);
 
+    // fast approximations, see fast_math.h
+    NSEEL_addfunc_retval("fsin", 1, NSEEL_PProc_THIS, &eelFastSin);
+    NSEEL_addfunc_retval("fcos", 1, NSEEL_PProc_THIS, &eelFastCos);
+    NSEEL_addfunc_retval("fexp2", 1, NSEEL_PProc_THIS, &eelFastExp2);
+    NSEEL_addfunc_retval("flog2", 1, NSEEL_PProc_THIS, &eelFastLog2);
+    NSEEL_addfunc_retval("ftanh", 1, NSEEL_PProc_THIS, &eelFastTanh);
+    NSEEL_addfunc_retval("fsoftclip", 1, NSEEL_PProc_THIS, &eelFastSoftclip);
+
     // state functions - act like macros
     NSEEL_addfunc_retval("delta", 2, NSEEL_PProc_THIS, &eelDelta);
     NSEEL_addfunc_retval("history", 2, NSEEL_PProc_THIS, &eelHistory);
     NSEEL_addfunc_retval("latch", 3, NSEEL_PProc_THIS, &eelLatch);
 
+    // filters - the filter state is kept in memory
+    NSEEL_addfunc_retval("onepole", 3, NSEEL_PProc_THIS, &eelOnePole);
+    NSEEL_addfunc_retval("onepoleCoef", 1, NSEEL_PProc_THIS, &eelOnePoleCoef);
+    NSEEL_addfunc_varparm("dcblock", 2, NSEEL_PProc_THIS, &eelDcBlock);
+    NSEEL_addfunc_retval("biquad", 3, NSEEL_PProc_THIS, &eelBiquad);
+    NSEEL_addfunc_retval("biquadLP", 3, NSEEL_PProc_THIS, &eelBiquadLP);
+    NSEEL_addfunc_retval("biquadHP", 3, NSEEL_PProc_THIS, &eelBiquadHP);
+    NSEEL_addfunc_retval("biquadBP", 3, NSEEL_PProc_THIS, &eelBiquadBP);
+    NSEEL_addfunc_retval("biquadNotch", 3, NSEEL_PProc_THIS, &eelBiquadNotch);
+    NSEEL_addfunc_varparm("svf", 4, NSEEL_PProc_THIS, &eelSvf);
+    NSEEL_addfunc_exparms("onepoleBlock", 4, NSEEL_PProc_THIS, &eelOnePoleBlock);
+    NSEEL_addfunc_varparm("dcblockBlock", 3, NSEEL_PProc_THIS, &eelDcBlockBlock);
+    NSEEL_addfunc_exparms("biquadBlock", 4, NSEEL_PProc_THIS, &eelBiquadBlock);
+
+    // tables and delay lines in memory
+    NSEEL_addfunc_retval("memReadL", 3, NSEEL_PProc_THIS, &eelMemReadL);
+    NSEEL_addfunc_retval("memReadC", 3, NSEEL_PProc_THIS, &eelMemReadC);
+    NSEEL_addfunc_exparms("memReadA", 4, NSEEL_PProc_THIS, &eelMemReadA);
+    NSEEL_addfunc_exparms("delayWrite", 4, NSEEL_PProc_THIS, &eelDelayWrite);
+    NSEEL_addfunc_varparm("delayRead", 4, NSEEL_PProc_THIS, &eelDelayRead);
+
+    // vector operations on memory ranges, see vector_ops.h
+    NSEEL_addfunc_exparms("memAdd", 4, NSEEL_PProc_THIS, &eelMemAdd);
+    NSEEL_addfunc_exparms("memMul", 4, NSEEL_PProc_THIS, &eelMemMul);
+    NSEEL_addfunc_exparms("memMac", 4, NSEEL_PProc_THIS, &eelMemMac);
+    NSEEL_addfunc_varparm("memScale", 4, NSEEL_PProc_THIS, &eelMemScale);
+    NSEEL_addfunc_exparms("memClip", 5, NSEEL_PProc_THIS, &eelMemClip);
+    NSEEL_addfunc_varparm("memCopy", 3, NSEEL_PProc_THIS, &eelMemCopy);
+    NSEEL_addfunc_retval("memMin", 2, NSEEL_PProc_THIS, &eelMemMin);
+    NSEEL_addfunc_retval("memMax", 2, NSEEL_PProc_THIS, &eelMemMax);
+    NSEEL_addfunc_retval("memPeak", 2, NSEEL_PProc_THIS, &eelMemPeak);
+    NSEEL_addfunc_retval("memRms", 2, NSEEL_PProc_THIS, &eelMemRms);
+    NSEEL_addfunc_retval("memDot", 3, NSEEL_PProc_THIS, &eelMemDot);
+
+    // matrices and feedback delay networks, see matrix_ops.h
+    NSEEL_addfunc_exparms("matMul", 5, NSEEL_PProc_THIS, &eelMatMul);
+    NSEEL_addfunc_retval("hadamard", 2, NSEEL_PProc_THIS, &eelHadamard);
+    NSEEL_addfunc_retval("householder", 2, NSEEL_PProc_THIS, &eelHouseholder);
+    NSEEL_addfunc_varparm("fdnStep", 7, NSEEL_PProc_THIS, &eelFdnStep);
+
     // inputs and outputs
     NSEEL_addfunc_retval("in", 1, NSEEL_PProc_THIS, &eelIn);
     NSEEL_addfunc_retptr("out", 1, NSEEL_PProc_THIS, &eelOut);
@@ -98,6 +138,10 @@ EEL2Adapter::EEL2Adapter(uint32 numInputChannels, uint32 numOutputChannels, int
     mUnit(unit) {}
 
 EEL2Adapter::~EEL2Adapter() {
+    for (auto code : mImportCode)
+        NSEEL_code_free(code);
+    if (mPrepareCode)
+        NSEEL_code_free(mPrepareCode);
     if (mInitCode)
         NSEEL_code_free(mInitCode);
     if (mBlockCode)
@@ -112,17 +156,72 @@ EEL2Adapter::~EEL2Adapter() {
 bool EEL2Adapter::init(const DynGenScript& script, const int* parameterIndices, int numParamIndices) {
     mEelState = NSEEL_VM_alloc();
 
+    // map the results of the @static section into our vm. The memory is accessed
+    // via 'gmem' and must be treated as read-only since it is shared by all instances.
+    if (script.mStaticData) {
+        mStaticData = script.mStaticData;
+        NSEEL_VM_SetGRAM(mEelState, &mStaticData->mMemory);
+        for (auto& [name, value] : mStaticData->mVariables) {
+            *NSEEL_VM_regvar(mEelState, name.c_str()) = value;
+        }
+    }
+
+    // with lanes, the inputs and outputs (unless summed) are distributed evenly among the lanes
+    if (script.mNumLanes > 1) {
+        mNumLanes = script.mNumLanes;
+        mSumLanes = script.mSumLanes;
+        if (mNumInputChannels % mNumLanes != 0 || (!mSumLanes && mNumOutputChannels % mNumLanes != 0)) {
+            Print("ERROR: DynGen: number of inputs and outputs must be divisible by the number of lanes (%d)\n",
+                  mNumLanes);
+            return false;
+        }
+        if (!script.mTaps.empty()) {
+            Print("ERROR: DynGen: @tap is not supported with @lanes\n");
+            return false;
+        }
+        mNumInputChannels /= mNumLanes;
+        if (!mSumLanes) {
+            mNumOutputChannels /= mNumLanes;
+        }
+        mLane = NSEEL_VM_regvar(mEelState, "lane");
+    }
+
+    // with oversampling, the script runs at a multiple of the sample rate and block size
+    if (script.mOversample > 1) {
+        if (!script.mTaps.empty()) {
+            Print("ERROR: DynGen: @tap is not supported with @oversample\n");
+            return false;
+        }
+        auto numInputs = mNumInputChannels * mNumLanes + numParamIndices;
+        auto numOutputs = mSumLanes ? mNumOutputChannels : mNumOutputChannels * mNumLanes;
+        mOversampler = std::make_unique<Oversampler>(script.mOversample, numInputs, numOutputs, mBlockSize);
+        mSampleRate *= script.mOversample;
+        mBlockSize *= script.mOversample;
+    }
+
+    // Allocate all our arrays with a single allocation, see Arena.
+    // NOTE: the number of "init triggers" is not known yet, so we assume the worst case.
+    auto& scriptParams = script.mParameters;
+    auto maxNumParameters = numParamIndices + scriptParams.size();
+    mArena.reserve(Arena::sizeOf<double*>(mNumInputChannels) + Arena::sizeOf<double>(mNumInputChannels * mNumLanes)
+                   + Arena::sizeOf<double*>(mNumOutputChannels) + Arena::sizeOf<double*>(maxNumParameters)
+                   + Arena::sizeOf<ParamType>(numParamIndices) + Arena::sizeOf<double>(numParamIndices) * 3);
+
     // obtain handles to input and output variables
-    mInputs = std::make_unique<double*[]>(mNumInputChannels);
+    char name[32];
+    mInputs = mArena.alloc<double*>(mNumInputChannels);
     for (int i = 0; i < mNumInputChannels; i++) {
-        std::string name = "in" + std::to_string(i);
-        mInputs[i] = NSEEL_VM_regvar(mEelState, name.c_str());
+        snprintf(name, sizeof(name), "in%d", i);
+        mInputs[i] = NSEEL_VM_regvar(mEelState, name);
     }
+    // Control rate inputs are interpolated over the block, so we need to cache the previous value.
+    // NOTE: the cache is initialized in the first process block.
+    mPrevInputValues = mArena.alloc<double>(mNumInputChannels * mNumLanes);
 
-    mOutputs = std::make_unique<double*[]>(mNumOutputChannels);
+    mOutputs = mArena.alloc<double*>(mNumOutputChannels);
     for (int i = 0; i < mNumOutputChannels; i++) {
-        std::string name = "out" + std::to_string(i);
-        mOutputs[i] = NSEEL_VM_regvar(mEelState, name.c_str());
+        snprintf(name, sizeof(name), "out%d", i);
+        mOutputs[i] = NSEEL_VM_regvar(mEelState, name);
     }
 
     // Initialize all script parameter variables to the specified value.
@@ -130,7 +229,6 @@ bool EEL2Adapter::init(const DynGenScript& script, const int* parameterIndices,
     // Also catch so called "init triggers". These are "trig" parameters with a *positive* init
     // value that are not modulated by the UGen because they have to be handled specially.
     // ("trig" parameters with a non-positive init value just stay at 0.0.)
-    auto& scriptParams = script.mParameters;
     double** initTriggers =
         script.mParameters.size() > 0 ? static_cast<double**>(alloca(scriptParams.size() * sizeof(double*))) : nullptr;
     int numInitTriggers = 0;
@@ -154,14 +252,22 @@ bool EEL2Adapter::init(const DynGenScript& script, const int* parameterIndices,
     // Since the parameter indices are fixed at synth creation time, we only have to
     // get pointers to the parameters at these indices. Note that parameter indices
     // are stable because parameter names are append-only.
-    mParameters = std::make_unique<double*[]>(numParamIndices + numInitTriggers);
-    mParameterTypes = std::make_unique<ParamType[]>(numParamIndices);
+    mParameters = mArena.alloc<double*>(numParamIndices + numInitTriggers);
+    mParameterTypes = mArena.alloc<ParamType>(numParamIndices);
+    // "lag" parameters are smoothed with a one-pole filter, see Lag UGen.
+    // NOTE: the filter state is initialized in the first process block.
+    mLagCoefs = mArena.alloc<double>(numParamIndices);
+    mLagState = mArena.alloc<double>(numParamIndices);
     for (int i = 0; i < numParamIndices; i++) {
         auto paramIndex = parameterIndices[i];
         if (paramIndex >= 0 && paramIndex < scriptParams.size()) {
             auto& spec = scriptParams[paramIndex];
             mParameters[i] = NSEEL_VM_regvar(mEelState, spec.name.c_str());
             mParameterTypes[i] = spec.type;
+            if (spec.type == ParamType::Lag && spec.lagTime > 0.0) {
+                // 60 dB decay time
+                mLagCoefs[i] = std::exp(std::log(0.001) / (spec.lagTime * mSampleRate));
+            }
         } else {
             // ignore out-of-range parameter indices
             Print("ERROR: Parameter index %d out of range\n", i);
@@ -179,8 +285,7 @@ bool EEL2Adapter::init(const DynGenScript& script, const int* parameterIndices,
     // NOTE: for "lin" parameters, the parameter cache will be initialized
     // in the first process block. For "trig" parameters, the cache must be
     // initialized with 0.0. For all other parameters, the cache is not used.
-    mPrevParamValues = std::make_unique<double[]>(numParamIndices);
-    std::fill_n(mPrevParamValues.get(), numParamIndices, 0.0);
+    mPrevParamValues = mArena.alloc<double>(numParamIndices);
 
     mNumParameters = numParamIndices;
     mNumInitTriggers = numInitTriggers;
@@ -197,15 +302,49 @@ bool EEL2Adapter::init(const DynGenScript& script, const int* parameterIndices,
     mBlockNum = NSEEL_VM_regvar(mEelState, "blockNum");
     mSampleNum = NSEEL_VM_regvar(mEelState, "sampleNum");
 
+    if (!initTaps(script)) {
+        return false;
+    }
+
     auto compileFlags = NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS | NSEEL_CODE_COMPILE_FLAG_NOFPSTATE;
 
+    // With @optimize, read-only constants are inlined as number literals so that
+    // the EEL2 compiler can fold constant subexpressions.
+    ConstantInliner inliner;
+    if (script.mOptimize) {
+        inliner.add("srate", mSampleRate);
+        inliner.add("blockSize", mBlockSize);
+        inliner.add("numIn", mNumInputChannels);
+        inliner.add("numOut", mNumOutputChannels);
+        for (auto section : { &script.mStatic, &script.mPrepare, &script.mInit, &script.mBlock, &script.mSample }) {
+            inliner.analyze(*section);
+        }
+        for (auto& library : script.mImports) {
+            inliner.analyze(library->code);
+        }
+    }
+    auto getCode = [&](const std::string& code) { return script.mOptimize ? inliner.apply(code) : code; };
+
+    // imported functions must be compiled before they can be used by the other sections
+    if (!compileImports(script, getCode)) {
+        return false;
+    }
+
     if (script.mSample.empty()) {
         Print("ERROR: DynGen sample code is missing\n");
         return false;
     }
 
+    if (!script.mPrepare.empty()) {
+        mPrepareCode = NSEEL_code_compile_ex(mEelState, getCode(script.mPrepare).c_str(), 0, compileFlags);
+        if (!mPrepareCode) {
+            Print("ERROR: DynGen @prepare compile error: %s\n", NSEEL_code_getcodeerror(mEelState));
+            return false;
+        }
+    }
+
     if (!script.mInit.empty()) {
-        mInitCode = NSEEL_code_compile_ex(mEelState, script.mInit.c_str(), 0, compileFlags);
+        mInitCode = NSEEL_code_compile_ex(mEelState, getCode(script.mInit).c_str(), 0, compileFlags);
         if (!mInitCode) {
             Print("ERROR: DynGen @init compile error: %s\n", NSEEL_code_getcodeerror(mEelState));
             return false;
@@ -213,22 +352,337 @@ bool EEL2Adapter::init(const DynGenScript& script, const int* parameterIndices,
     }
 
     if (!script.mBlock.empty()) {
-        mBlockCode = NSEEL_code_compile_ex(mEelState, script.mBlock.c_str(), 0, compileFlags);
+        mBlockCode = NSEEL_code_compile_ex(mEelState, getCode(script.mBlock).c_str(), 0, compileFlags);
         if (!mBlockCode) {
             Print("ERROR: DynGen @block compile error %s\n", NSEEL_code_getcodeerror(mEelState));
             return false;
         }
     }
 
-    mSampleCode = NSEEL_code_compile_ex(mEelState, script.mSample.c_str(), 0, compileFlags);
+    mSampleCode = NSEEL_code_compile_ex(mEelState, getCode(script.mSample).c_str(), 0, compileFlags);
     if (!mSampleCode) {
         Print("ERROR: DynGen @sample compile error: %s\n", NSEEL_code_getcodeerror(mEelState));
         return false;
     }
+    // see process()
+    mSampleStateless = isStatelessSection(script.mSample);
+
+    if (mNumLanes > 1) {
+        // all variables have been registered during compilation
+        NSEEL_VM_enumallvars(
+            mEelState,
+            [](const char*, EEL_F* value, void* userData) {
+                static_cast<std::vector<double*>*>(userData)->push_back(value);
+                return 1; // continue
+            },
+            &mLaneVars);
+        mLaneState = std::make_unique<double[]>(mLaneVars.size() * mNumLanes);
+    }
+
+    return true;
+}
+
+void EEL2Adapter::processOversampled(Wire** inputs, float** outBuf, Wire** parameterPairs, double* newParamValues,
+                                     int numSamples) {
+    auto numInputs = mNumInputChannels * mNumLanes;
+    auto numOutputs = mSumLanes ? mNumOutputChannels : mNumOutputChannels * mNumLanes;
+    auto factor = mOversampler->factor();
+
+    // Replace audio rate inputs and parameters with upsampled copies. Control rate inputs
+    // and parameters are simply interpolated over the longer block.
+    auto wires = static_cast<Wire*>(alloca((numInputs + mNumParameters) * sizeof(Wire)));
+    auto upInputs = static_cast<Wire**>(alloca(numInputs * sizeof(Wire*)));
+    for (int i = 0; i < numInputs; i++) {
+        if (inputs[i]->mCalcRate == calc_FullRate) {
+            wires[i] = *inputs[i];
+            wires[i].mBuffer = mOversampler->upsample(i, inputs[i]->mBuffer, numSamples);
+            upInputs[i] = &wires[i];
+        } else {
+            upInputs[i] = inputs[i];
+        }
+    }
+    Wire** upParameterPairs = nullptr;
+    if (mNumParameters > 0) {
+        upParameterPairs = static_cast<Wire**>(alloca(mNumParameters * 2 * sizeof(Wire*)));
+        std::copy_n(parameterPairs, mNumParameters * 2, upParameterPairs);
+        for (int i = 0; i < mNumParameters; i++) {
+            Wire* wire = parameterPairs[i * 2 + 1];
+            if (wire->mCalcRate == calc_FullRate) {
+                auto& upWire = wires[numInputs + i];
+                upWire = *wire;
+                // Do not filter "trig" and "step" parameters, the ringing could cause spurious
+                // triggers resp. invalid buffer numbers or channel indices.
+                auto type = mParameterTypes[i];
+                if (type == ParamType::Trigger || type == ParamType::Step) {
+                    upWire.mBuffer = mOversampler->hold(numInputs + i, wire->mBuffer, numSamples);
+                } else {
+                    upWire.mBuffer = mOversampler->upsample(numInputs + i, wire->mBuffer, numSamples);
+                }
+                upParameterPairs[i * 2 + 1] = &upWire;
+            }
+        }
+    }
+    auto upOutputs = static_cast<float**>(alloca(numOutputs * sizeof(float*)));
+    for (int i = 0; i < numOutputs; i++) {
+        upOutputs[i] = mOversampler->outputBuffer(i);
+    }
+
+    if (mNumLanes > 1) {
+        processLanes(upInputs, upOutputs, upParameterPairs, newParamValues, numSamples * factor);
+    } else {
+        processLane(upInputs, upOutputs, upParameterPairs, newParamValues, mPrevInputValues, numSamples * factor,
+                    false);
+    }
+
+    for (int i = 0; i < numOutputs; i++) {
+        mOversampler->downsample(i, outBuf[i], numSamples);
+    }
+}
+
+bool EEL2Adapter::setVariable(const char* name, double value) {
+    auto var = NSEEL_VM_getvar(mEelState, name);
+    if (!var) {
+        return false;
+    }
+    *var = value;
+    // processLanes() restores the variables of each lane from its snapshot,
+    // so we have to update all snapshots. Before the first block, the snapshots
+    // are still taken from the VM variables.
+    if (mLaneState && mBlockCounter > 0) {
+        auto numVars = mLaneVars.size();
+        auto it = std::find(mLaneVars.begin(), mLaneVars.end(), var);
+        if (it != mLaneVars.end()) {
+            auto index = it - mLaneVars.begin();
+            for (int lane = 0; lane < mNumLanes; lane++) {
+                mLaneState[lane * numVars + index] = value;
+            }
+        }
+    }
+    return true;
+}
+
+void EEL2Adapter::processLanes(Wire** inputs, float** outBuf, Wire** parameterPairs, double* newParamValues,
+                               int numSamples) {
+    auto numVars = mLaneVars.size();
+    if (mBlockCounter == 0) {
+        // all lanes start with the variables set by the @prepare section.
+        for (int lane = 0; lane < mNumLanes; lane++) {
+            for (size_t k = 0; k < numVars; k++) {
+                mLaneState[lane * numVars + k] = *mLaneVars[k];
+            }
+        }
+    }
+    // every lane runs through the same samples
+    auto sampleCounter = mSampleCounter;
+    // all lanes see the same parameters, so they also share the filter state of "lag" parameters
+    double* lagState = nullptr;
+    if (mNumParameters > 0) {
+        lagState = static_cast<double*>(alloca(mNumParameters * sizeof(double)));
+        std::copy_n(mLagState, mNumParameters, lagState);
+    }
+    for (int lane = 0; lane < mNumLanes; lane++) {
+        double* state = &mLaneState[lane * numVars];
+        for (size_t k = 0; k < numVars; k++) {
+            *mLaneVars[k] = state[k];
+        }
+        std::copy_n(lagState, mNumParameters, mLagState);
+        *mLane = lane;
+        mSampleCounter = sampleCounter;
+
+        auto laneInputs = inputs + lane * mNumInputChannels;
+        auto laneOutputs = mSumLanes ? outBuf : outBuf + lane * mNumOutputChannels;
+        processLane(laneInputs, laneOutputs, parameterPairs, newParamValues,
+                    &mPrevInputValues[lane * mNumInputChannels], numSamples, mSumLanes && lane > 0);
+
+        for (size_t k = 0; k < numVars; k++) {
+            state[k] = *mLaneVars[k];
+        }
+    }
+}
+
+void EEL2Adapter::prepare(const float* parameterValues) {
+    if (!mPrepareCode) {
+        return;
+    }
+
+    // Set the modulated parameters to their initial values, just like in the first block.
+    // Unmodulated parameters already hold their init value. Inputs are not available yet!
+    for (int i = 0; i < mNumParameters; ++i) {
+        if (double* param = mParameters[i]) {
+            double value = static_cast<double>(parameterValues[i]);
+            if (mParameterTypes[i] == ParamType::Trigger) {
+                *param = value > 0.0 ? 1.0 : 0.0;
+            } else {
+                *param = value;
+            }
+        }
+    }
+    // "init triggers" start with a positive value
+    for (int i = 0; i < mNumInitTriggers; ++i) {
+        *mParameters[mNumParameters + i] = 1.0;
+    }
+
+    // The unit might be freed while we are running on the NRT thread, so we hide it
+    // from the script; buffer access and done actions then simply do nothing.
+    auto unit = mUnit;
+    mUnit = nullptr;
+    NSEEL_code_execute(mPrepareCode);
+    mUnit = unit;
+}
+
+bool EEL2Adapter::evalStatic(const DynGenScript& script, DynGenStaticData& data, World* world) {
+    // a temporary vm without inputs and outputs
+    EEL2Adapter adapter(0, 0, static_cast<int>(world->mSampleRate), world->mBufLength, world, nullptr);
+    adapter.mEelState = NSEEL_VM_alloc();
+    NSEEL_VM_SetCustomFuncThis(adapter.mEelState, &adapter);
+    // the vm only borrows the memory, it is owned by 'data'
+    NSEEL_VM_SetGRAM(adapter.mEelState, &data.mMemory);
+
+    // only constants which are the same for all instances are available
+    *NSEEL_VM_regvar(adapter.mEelState, "srate") = adapter.mSampleRate;
+    *NSEEL_VM_regvar(adapter.mEelState, "blockSize") = adapter.mBlockSize;
+
+    if (!adapter.compileImports(script, [](const std::string& code) -> const std::string& { return code; })) {
+        return false;
+    }
+
+    auto compileFlags = NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS | NSEEL_CODE_COMPILE_FLAG_NOFPSTATE;
+    auto code = NSEEL_code_compile_ex(adapter.mEelState, script.mStatic.c_str(), 0, compileFlags);
+    if (!code) {
+        Print("ERROR: DynGen @static compile error: %s\n", NSEEL_code_getcodeerror(adapter.mEelState));
+        return false;
+    }
+    NSEEL_code_execute(code);
+    NSEEL_code_free(code);
+
+    // take a snapshot of all variables so they can be copied to the instances
+    NSEEL_VM_enumallvars(
+        adapter.mEelState,
+        [](const char* name, EEL_F* value, void* userData) {
+            if (std::strcmp(name, "srate") != 0 && std::strcmp(name, "blockSize") != 0) {
+                static_cast<DynGenStaticData*>(userData)->mVariables.emplace_back(name, *value);
+            }
+            return 1; // continue
+        },
+        &data);
+
+    return true;
+}
+
+bool EEL2Adapter::tryCompileLibrary(const DynGenFunctionLibrary& library) {
+    EEL2Adapter adapter(0, 0, 0, 0, nullptr, nullptr);
+    adapter.mEelState = NSEEL_VM_alloc();
+    NSEEL_VM_SetCustomFuncThis(adapter.mEelState, &adapter);
+
+    auto compileFlags = NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS | NSEEL_CODE_COMPILE_FLAG_NOFPSTATE;
+    auto code = NSEEL_code_compile_ex(adapter.mEelState, library.code.c_str(), 0, compileFlags);
+    if (!code) {
+        Print("ERROR: DynGen function library '%s' compile error: %s\n", library.name.c_str(),
+              NSEEL_code_getcodeerror(adapter.mEelState));
+        return false;
+    }
+    adapter.mImportCode.push_back(code);
+    return true;
+}
+
+template <typename GetCode> bool EEL2Adapter::compileImports(const DynGenScript& script, GetCode&& getCode) {
+    auto compileFlags = NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS | NSEEL_CODE_COMPILE_FLAG_NOFPSTATE;
+    for (auto& library : script.mImports) {
+        auto code = NSEEL_code_compile_ex(mEelState, getCode(library->code).c_str(), 0, compileFlags);
+        if (!code) {
+            Print("ERROR: DynGen function library '%s' compile error: %s\n", library->name.c_str(),
+                  NSEEL_code_getcodeerror(mEelState));
+            return false;
+        }
+        mImportCode.push_back(code);
+    }
+    return true;
+}
 
+bool EEL2Adapter::initTaps(const DynGenScript& script) {
+    mTaps.reserve(script.mTaps.size());
+    for (auto& spec : script.mTaps) {
+        Tap tap;
+        tap.rate = spec.rate;
+        if (spec.bufNum >= 0) {
+            tap.bufNum = spec.bufNum;
+        } else {
+            tap.bufNumVar = NSEEL_VM_regvar(mEelState, spec.buffer.c_str());
+        }
+        if (!spec.position.empty()) {
+            tap.position = NSEEL_VM_regvar(mEelState, spec.position.c_str());
+        }
+        for (auto& target : spec.targets) {
+            if (!target.variable.empty()) {
+                auto var = NSEEL_VM_regvar(mEelState, target.variable.c_str());
+                tap.sources.push_back({ var, 0, 1, var });
+            } else {
+                // we only resolve a single pointer per block, so the range must not cross a memory block
+                auto start = target.memStart;
+                auto end = target.memStart + target.memCount - 1;
+                if ((start / NSEEL_RAM_ITEMSPERBLOCK) != (end / NSEEL_RAM_ITEMSPERBLOCK)) {
+                    Print("ERROR: @tap: memory range [%d:%d] must not cross a multiple of %d\n", target.memStart,
+                          target.memCount, NSEEL_RAM_ITEMSPERBLOCK);
+                    return false;
+                }
+                tap.sources.push_back({ nullptr, target.memStart, target.memCount, nullptr });
+            }
+        }
+        if (tap.rate == TapRate::Sample) {
+            mHasSampleTaps = true;
+        } else {
+            mHasBlockTaps = true;
+        }
+        mTaps.push_back(std::move(tap));
+    }
     return true;
 }
 
+void EEL2Adapter::resolveTaps() {
+    for (auto& tap : mTaps) {
+        auto bufNum = tap.bufNumVar ? static_cast<int>(*tap.bufNumVar) : tap.bufNum;
+        tap.buf = getBuffer(bufNum);
+        if (tap.buf && (!tap.buf->data || tap.buf->frames <= 0)) {
+            tap.buf = nullptr;
+        }
+        for (auto& source : tap.sources) {
+            if (!source.variable) {
+                // do not allocate memory on the audio thread; memory that has
+                // not been touched by the script yet is simply written as zeros.
+                int numValid = 0;
+                source.data = NSEEL_VM_getramptr_noalloc(mEelState, source.memStart, &numValid);
+            }
+        }
+    }
+}
+
+void EEL2Adapter::writeTaps(TapRate rate) {
+    for (auto& tap : mTaps) {
+        if (tap.rate != rate || !tap.buf) {
+            continue;
+        }
+        auto buf = tap.buf;
+        LOCK_SNDBUF(buf);
+        // the buffer might have changed
+        if (tap.writePos >= buf->frames) {
+            tap.writePos = 0;
+        }
+        float* frame = buf->data + tap.writePos * buf->channels;
+        int channel = 0;
+        for (auto& source : tap.sources) {
+            for (int i = 0; i < source.count && channel < buf->channels; ++i, ++channel) {
+                frame[channel] = source.data ? static_cast<float>(source.data[i]) : 0.f;
+            }
+        }
+        if (++tap.writePos >= buf->frames) {
+            tap.writePos = 0;
+        }
+        if (tap.position) {
+            *tap.position = tap.writePos;
+        }
+    }
+}
+
 EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBufRead(void* opaque, const INT_PTR numParams, EEL_F** params) {
     const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
     const auto buf = eel2Adapter->getBuffer(static_cast<int>(*params[0]));
@@ -275,6 +729,30 @@ EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBufReadL(void* opaque, const INT_PTR numPa
     return lininterp(frac, getSample(buf, chanOffset, lowerIndex), getSample(buf, chanOffset, upperIndex));
 }
 
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelWavetable(void* opaque, EEL_F* bufNum, EEL_F* phase, EEL_F* increment) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    const auto buf = eel2Adapter->getBuffer(static_cast<int>(*bufNum));
+    if (buf == nullptr || buf->frames <= 0) {
+        return 0.0;
+    }
+
+    LOCK_SNDBUF_SHARED(buf);
+    // only use the wavetable if it has been built from the current buffer data
+    auto table = eel2Adapter->getWavetable(static_cast<int>(*bufNum), buf);
+    if (table) {
+        return table->read(*phase, *increment);
+    }
+    // otherwise read the first channel without band-limiting
+    if (!std::isfinite(*phase)) {
+        return 0.0;
+    }
+    const double pos = (*phase - std::floor(*phase)) * buf->frames;
+    const auto lowerIndex = std::min(static_cast<int>(pos), buf->frames - 1);
+    const auto upperIndex = (lowerIndex + 1) % buf->frames;
+    const float frac = static_cast<float>(pos - lowerIndex);
+    return lininterp(frac, getSample(buf, 0, lowerIndex), getSample(buf, 0, upperIndex));
+}
+
 EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBufReadC(void* opaque, const INT_PTR numParams, EEL_F** params) {
     const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
     const auto buf = eel2Adapter->getBuffer(static_cast<int>(*params[0]));
@@ -359,14 +837,19 @@ EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBufChannels(void* opaque, EEL_F* bufNum) {
 
 EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelSetDone(void* opaque, EEL_F* param) {
     const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
-    eel2Adapter->mUnit->mDone = (*param != 0.0);
+    // there is no Unit in the @static section
+    if (eel2Adapter->mUnit) {
+        eel2Adapter->mUnit->mDone = (*param != 0.0);
+    }
     return 0.0;
 }
 
 EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelDoneAction(void* opaque, EEL_F* param) {
     const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
     const int doneAction = static_cast<int>(*param);
-    DoneAction(doneAction, eel2Adapter->mUnit);
+    if (eel2Adapter->mUnit) {
+        DoneAction(doneAction, eel2Adapter->mUnit);
+    }
     return 0.0;
 }
 
@@ -386,8 +869,8 @@ EEL_F_PTR NSEEL_CGEN_CALL EEL2Adapter::eelOut(void* opaque, EEL_F* param) {
     if (channel >= 0 && channel < eel2Adapter->mNumOutputChannels) {
         return eel2Adapter->mOutputs[channel];
     } else {
-        static double nullOutput = 0.0;
-        return &nullOutput;
+        // NOTE: don't use a global variable because it would be written by several (Supernova) DSP threads
+        return &eel2Adapter->mNullOutput;
     };
 }
 
@@ -417,16 +900,31 @@ EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMod(void*, EEL_F* in, EEL_F* hi) { return
 // from SC_SndBuf but adjusted for doubles - added eel_ prefix to avoid clashes from SC_SndBuf
 EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelLininterp(void*, EEL_F* x, EEL_F* a, EEL_F* b) { return *a + *x * (*b - *a); }
 
-EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelCubicinterp(void*, const INT_PTR numParams, EEL_F** params) {
-    // 4-point, 3rd-order Hermite (x-form)
-    EEL_F c0 = *params[2];
-    EEL_F c1 = 0.5f * (*params[3] - *params[1]);
-    EEL_F c2 = *params[1] - 2.5f * *params[2] + 2.f * *params[3] - 0.5f * *params[4];
-    EEL_F c3 = 0.5f * (*params[4] - *params[1]) + 1.5f * (*params[2] - *params[3]);
+// 4-point, 3rd-order Hermite (x-form)
+static double hermite(double x, double y0, double y1, double y2, double y3) {
+    double c0 = y1;
+    double c1 = 0.5 * (y2 - y0);
+    double c2 = y0 - 2.5 * y1 + 2.0 * y2 - 0.5 * y3;
+    double c3 = 0.5 * (y3 - y0) + 1.5 * (y1 - y2);
+    return ((c3 * x + c2) * x + c1) * x + c0;
+}
 
-    return ((c3 * *params[0] + c2) * *params[0] + c1) * *params[0] + c0;
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelCubicinterp(void*, const INT_PTR numParams, EEL_F** params) {
+    return hermite(*params[0], *params[1], *params[2], *params[3], *params[4]);
 }
 
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelFastSin(void*, EEL_F* x) { return fastmath::sin(*x); }
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelFastCos(void*, EEL_F* x) { return fastmath::cos(*x); }
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelFastExp2(void*, EEL_F* x) { return fastmath::exp2(*x); }
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelFastLog2(void*, EEL_F* x) { return fastmath::log2(*x); }
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelFastTanh(void*, EEL_F* x) { return fastmath::tanh(*x); }
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelFastSoftclip(void*, EEL_F* x) { return fastmath::softclip(*x); }
+
 EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelDelta(void*, EEL_F* state, EEL_F* signal) {
     EEL_F delta = *signal - *state;
     *state = *signal;
@@ -446,6 +944,687 @@ EEL_F EEL2Adapter::eelLatch(void*, EEL_F* state, EEL_F* signal, EEL_F* trigger)
     return *state;
 }
 
+// this is EEL's way of converting a double to an index/offset...
+static int toMemoryIndex(EEL_F value) { return static_cast<int>(value + 0.0001); }
+
+/*! @brief returns a pointer to 'count' contiguous values in the memory of the script,
+ *  or NULL if the range is out of bounds or crosses a memory block boundary.
+ */
+static double* getMemorySlots(const EEL2Adapter* adapter, EEL_F index, int count) {
+    const int offset = toMemoryIndex(index);
+    if (offset < 0) {
+        return nullptr;
+    }
+    int numValid = 0;
+    double* data = adapter->getMemory(offset, numValid);
+    return (data && numValid >= count) ? data : nullptr;
+}
+
+/*! @brief copies 'count' values from the memory of the script into 'dst', chunk by chunk,
+ *  so that the range may cross memory block boundaries. Returns false if the range is out of bounds.
+ */
+static bool readMemorySlots(const EEL2Adapter* adapter, EEL_F index, int count, double* dst) {
+    int offset = toMemoryIndex(index);
+    while (offset >= 0 && count > 0) {
+        int numValid = 0;
+        const double* data = adapter->getMemory(offset, numValid);
+        if (!data || numValid <= 0) {
+            return false;
+        }
+        int n = std::min(count, numValid);
+        dst = std::copy_n(data, n, dst);
+        offset += n;
+        count -= n;
+    }
+    return count == 0;
+}
+
+/*! @brief the counterpart of readMemorySlots() */
+static bool writeMemorySlots(const EEL2Adapter* adapter, EEL_F index, int count, const double* src) {
+    int offset = toMemoryIndex(index);
+    while (offset >= 0 && count > 0) {
+        int numValid = 0;
+        double* data = adapter->getMemory(offset, numValid);
+        if (!data || numValid <= 0) {
+            return false;
+        }
+        int n = std::min(count, numValid);
+        std::copy_n(src, n, data);
+        src += n;
+        offset += n;
+        count -= n;
+    }
+    return count == 0;
+}
+
+/*! @brief dst = matrix * src, where the matrix is stored in the memory of the script.
+ *  If the matrix crosses a memory block boundary, it is read row by row.
+ *  Returns false if the matrix is out of bounds.
+ */
+static bool matVecMemory(const EEL2Adapter* adapter, double* dst, EEL_F matrixIndex, const double* src, int rows,
+                         int cols) {
+    if (auto matrix = getMemorySlots(adapter, matrixIndex, rows * cols)) {
+        matrixops::matVec(dst, matrix, src, rows, cols);
+        return true;
+    }
+    double row[matrixops::kMaxSize];
+    for (int r = 0; r < rows; r++) {
+        if (!readMemorySlots(adapter, matrixIndex + static_cast<double>(r) * cols, cols, row)) {
+            return false;
+        }
+        matrixops::matVec(dst + r, row, src, 1, cols);
+    }
+    return true;
+}
+
+/*! @brief calls 'fn(data, n)' for every contiguous chunk of the given memory range */
+template <typename Fn> static void forEachMemoryChunk(const EEL2Adapter* adapter, EEL_F index, EEL_F size, Fn&& fn) {
+    int offset = toMemoryIndex(index);
+    int count = toMemoryIndex(size);
+    while (offset >= 0 && count > 0) {
+        int numValid = 0;
+        double* data = adapter->getMemory(offset, numValid);
+        if (!data || numValid <= 0) {
+            return;
+        }
+        int n = std::min(count, numValid);
+        fn(data, n);
+        offset += n;
+        count -= n;
+    }
+}
+
+/*! @brief calls 'fn(data, n)' for every chunk of the given memory ranges (of the same size),
+ *  where 'data' is an array of pointers and all ranges are contiguous.
+ */
+template <size_t N, typename Fn>
+static void forEachMemoryChunk(const EEL2Adapter* adapter, const std::array<EEL_F, N>& indices, EEL_F size,
+                               Fn&& fn) {
+    std::array<int, N> offsets;
+    for (size_t k = 0; k < N; k++) {
+        offsets[k] = toMemoryIndex(indices[k]);
+        if (offsets[k] < 0) {
+            return;
+        }
+    }
+    int count = toMemoryIndex(size);
+    while (count > 0) {
+        std::array<double*, N> data;
+        int n = count;
+        for (size_t k = 0; k < N; k++) {
+            int numValid = 0;
+            data[k] = adapter->getMemory(offsets[k], numValid);
+            if (!data[k] || numValid <= 0) {
+                return;
+            }
+            n = std::min(n, numValid);
+        }
+        fn(data, n);
+        for (auto& offset : offsets) {
+            offset += n;
+        }
+        count -= n;
+    }
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelOnePole(void* opaque, EEL_F* state, EEL_F* signal, EEL_F* coef) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    if (auto s = getMemorySlots(eel2Adapter, *state, filters::kOnePoleState)) {
+        return filters::onePole(s, *signal, *coef);
+    }
+    return *signal;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelOnePoleCoef(void* opaque, EEL_F* freq) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    return filters::onePoleCoef(*freq, eel2Adapter->mSampleRate);
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelDcBlock(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    // same default as LeakDC
+    double coef = numParams > 2 ? *params[2] : 0.995;
+    if (auto s = getMemorySlots(eel2Adapter, *params[0], filters::kDcBlockState)) {
+        return filters::dcBlock(s, *params[1], coef);
+    }
+    return *params[1];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBiquad(void* opaque, EEL_F* state, EEL_F* signal, EEL_F* coefs) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    auto s = getMemorySlots(eel2Adapter, *state, filters::kBiquadState);
+    auto c = getMemorySlots(eel2Adapter, *coefs, filters::kBiquadCoefs);
+    if (s && c) {
+        return filters::biquad(s, *signal, c);
+    }
+    return *signal;
+}
+
+static EEL_F setBiquadCoefs(EEL2Adapter* adapter, filters::BiquadType type, EEL_F* coefs, double freq, double q,
+                            double sampleRate) {
+    if (auto c = getMemorySlots(adapter, *coefs, filters::kBiquadCoefs)) {
+        filters::biquadCoefs(c, type, freq, q, sampleRate);
+    }
+    return *coefs;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBiquadLP(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    return setBiquadCoefs(eel2Adapter, filters::BiquadType::Lowpass, coefs, *freq, *q, eel2Adapter->mSampleRate);
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBiquadHP(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    return setBiquadCoefs(eel2Adapter, filters::BiquadType::Highpass, coefs, *freq, *q, eel2Adapter->mSampleRate);
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBiquadBP(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    return setBiquadCoefs(eel2Adapter, filters::BiquadType::Bandpass, coefs, *freq, *q, eel2Adapter->mSampleRate);
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBiquadNotch(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    return setBiquadCoefs(eel2Adapter, filters::BiquadType::Notch, coefs, *freq, *q, eel2Adapter->mSampleRate);
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelSvf(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    auto mode = numParams > 4 ? static_cast<int>(*params[4]) : 0;
+    if (mode < 0 || mode > 3) {
+        mode = 0;
+    }
+    if (auto s = getMemorySlots(eel2Adapter, *params[0], filters::kSvfState)) {
+        return filters::svf(s, *params[1], *params[2], *params[3], static_cast<filters::SvfMode>(mode),
+                            eel2Adapter->mSampleRate);
+    }
+    return *params[1];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelOnePoleBlock(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // onepoleBlock(state, buf, size, coef)
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double coef = *params[3];
+    if (auto s = getMemorySlots(eel2Adapter, *params[0], filters::kOnePoleState)) {
+        // copy the state to a local variable so the compiler can keep it in a register
+        double state[filters::kOnePoleState] = { s[0] };
+        forEachMemoryChunk(eel2Adapter, *params[1], *params[2], [&](double* data, int n) {
+            for (int i = 0; i < n; i++) {
+                data[i] = filters::onePole(state, data[i], coef);
+            }
+        });
+        s[0] = state[0];
+    }
+    return *params[1];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelDcBlockBlock(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // dcblockBlock(state, buf, size, [coef])
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double coef = numParams > 3 ? *params[3] : 0.995;
+    if (auto s = getMemorySlots(eel2Adapter, *params[0], filters::kDcBlockState)) {
+        double state[filters::kDcBlockState] = { s[0], s[1] };
+        forEachMemoryChunk(eel2Adapter, *params[1], *params[2], [&](double* data, int n) {
+            for (int i = 0; i < n; i++) {
+                data[i] = filters::dcBlock(state, data[i], coef);
+            }
+        });
+        s[0] = state[0];
+        s[1] = state[1];
+    }
+    return *params[1];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelBiquadBlock(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // biquadBlock(state, coefs, buf, size)
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    auto s = getMemorySlots(eel2Adapter, *params[0], filters::kBiquadState);
+    auto c = getMemorySlots(eel2Adapter, *params[1], filters::kBiquadCoefs);
+    if (s && c) {
+        double state[filters::kBiquadState] = { s[0], s[1] };
+        double coefs[filters::kBiquadCoefs] = { c[0], c[1], c[2], c[3], c[4] };
+        forEachMemoryChunk(eel2Adapter, *params[2], *params[3], [&](double* data, int n) {
+            for (int i = 0; i < n; i++) {
+                data[i] = filters::biquad(state, data[i], coefs);
+            }
+        });
+        s[0] = state[0];
+        s[1] = state[1];
+    }
+    return *params[2];
+}
+
+/*! @brief a memory range of the script that is used as a table or circular buffer.
+ *  If the range lies within a single memory block (the common case), the values are accessed
+ *  directly; otherwise every access has to look up the memory block.
+ */
+class MemoryRange {
+public:
+    MemoryRange(const EEL2Adapter* adapter, EEL_F index, EEL_F size):
+        mAdapter(adapter), mOffset(toMemoryIndex(index)), mSize(toMemoryIndex(size)) {
+        if (mOffset < 0 || mSize <= 0) {
+            mSize = 0;
+            return;
+        }
+        int numValid = 0;
+        double* data = adapter->getMemory(mOffset, numValid);
+        if (data && numValid >= mSize) {
+            mData = data;
+        }
+    }
+
+    bool valid() const { return mSize > 0; }
+
+    /*! @brief returns the data if the range lies within a single memory block, otherwise NULL */
+    double* data() const { return mData; }
+
+    int size() const { return mSize; }
+
+    /*! @brief 'i' must be within [0, size) */
+    double get(int i) const {
+        if (mData) {
+            return mData[i];
+        }
+        int numValid = 0;
+        double* data = mAdapter->getMemory(mOffset + i, numValid);
+        return data ? *data : 0.0;
+    }
+
+    /*! @brief 'i' must be within [0, size) */
+    void set(int i, double value) const {
+        if (mData) {
+            mData[i] = value;
+        } else {
+            int numValid = 0;
+            if (double* data = mAdapter->getMemory(mOffset + i, numValid)) {
+                *data = value;
+            }
+        }
+    }
+
+    /*! @brief wraps an integer index to [0, size) */
+    int wrap(int i) const {
+        i %= mSize;
+        return i < 0 ? i + mSize : i;
+    }
+
+    /*! @brief wraps a fractional position to [0, size) and splits it into index and fraction */
+    bool split(double pos, int& index, double& frac) const {
+        if (!std::isfinite(pos)) {
+            return false;
+        }
+        double wrapped = pos - std::floor(pos / mSize) * mSize;
+        index = std::min(static_cast<int>(wrapped), mSize - 1);
+        frac = wrapped - index;
+        return true;
+    }
+
+    double readN(double pos) const {
+        int index;
+        double frac;
+        return split(pos, index, frac) ? get(index) : 0.0;
+    }
+
+    double readL(double pos) const {
+        int index;
+        double frac;
+        if (!split(pos, index, frac)) {
+            return 0.0;
+        }
+        double a = get(index);
+        double b = get(wrap(index + 1));
+        return a + frac * (b - a);
+    }
+
+    double readC(double pos) const {
+        int index;
+        double frac;
+        if (!split(pos, index, frac)) {
+            return 0.0;
+        }
+        return hermite(frac, get(wrap(index - 1)), get(index), get(wrap(index + 1)), get(wrap(index + 2)));
+    }
+
+    /*! @brief first-order allpass interpolation, see DelayA UGen. It has a flat frequency response,
+     *  but needs the previous output as state, so it only works for (mostly) steady read positions.
+     */
+    double readA(double pos, double& state) const {
+        int index;
+        double frac;
+        if (!split(pos, index, frac)) {
+            return 0.0;
+        }
+        double coef = frac / (2.0 - frac);
+        double y = get(index) + coef * (get(wrap(index + 1)) - state);
+        state = y;
+        return y;
+    }
+
+private:
+    const EEL2Adapter* mAdapter;
+    int mOffset;
+    int mSize;
+    double* mData = nullptr;
+};
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemReadL(void* opaque, EEL_F* buf, EEL_F* size, EEL_F* pos) {
+    MemoryRange range(static_cast<EEL2Adapter*>(opaque), *buf, *size);
+    return range.valid() ? range.readL(*pos) : 0.0;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemReadC(void* opaque, EEL_F* buf, EEL_F* size, EEL_F* pos) {
+    MemoryRange range(static_cast<EEL2Adapter*>(opaque), *buf, *size);
+    return range.valid() ? range.readC(*pos) : 0.0;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemReadA(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // memReadA(state, buf, size, pos)
+    MemoryRange range(static_cast<EEL2Adapter*>(opaque), *params[1], *params[2]);
+    return range.valid() ? range.readA(*params[3], *params[0]) : 0.0;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelDelayWrite(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // delayWrite(writePos, buf, size, signal)
+    MemoryRange range(static_cast<EEL2Adapter*>(opaque), *params[1], *params[2]);
+    if (range.valid()) {
+        int writePos;
+        double frac;
+        if (!range.split(*params[0], writePos, frac)) {
+            writePos = 0;
+        }
+        range.set(writePos, *params[3]);
+        *params[0] = range.wrap(writePos + 1);
+    }
+    return *params[3];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelDelayRead(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // delayRead(writePos, buf, size, delay, [interpolation])
+    MemoryRange range(static_cast<EEL2Adapter*>(opaque), *params[1], *params[2]);
+    if (!range.valid()) {
+        return 0.0;
+    }
+    // the last written sample (= delay 0) is at writePos - 1
+    double pos = *params[0] - 1.0 - *params[3];
+    // same as BufRd
+    auto interpolation = numParams > 4 ? static_cast<int>(*params[4]) : 2;
+    switch (interpolation) {
+    case 1:
+        return range.readN(pos);
+    case 4:
+        return range.readC(pos);
+    default:
+        return range.readL(pos);
+    }
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemAdd(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // memAdd(dst, a, b, size)
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    forEachMemoryChunk<3>(eel2Adapter, { *params[0], *params[1], *params[2] }, *params[3],
+                          [](auto& data, int n) { vecops::add(data[0], data[1], data[2], n); });
+    return *params[0];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemMul(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // memMul(dst, a, b, size)
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    forEachMemoryChunk<3>(eel2Adapter, { *params[0], *params[1], *params[2] }, *params[3],
+                          [](auto& data, int n) { vecops::mul(data[0], data[1], data[2], n); });
+    return *params[0];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemMac(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // memMac(dst, a, b, size)
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    forEachMemoryChunk<3>(eel2Adapter, { *params[0], *params[1], *params[2] }, *params[3],
+                          [](auto& data, int n) { vecops::mac(data[0], data[1], data[2], n); });
+    return *params[0];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemScale(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // memScale(dst, src, size, mul, [add])
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double mul = *params[3];
+    double add = numParams > 4 ? *params[4] : 0.0;
+    forEachMemoryChunk<2>(eel2Adapter, { *params[0], *params[1] }, *params[2],
+                          [&](auto& data, int n) { vecops::scale(data[0], data[1], n, mul, add); });
+    return *params[0];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemClip(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // memClip(dst, src, size, lo, hi)
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double lo = *params[3];
+    double hi = *params[4];
+    forEachMemoryChunk<2>(eel2Adapter, { *params[0], *params[1] }, *params[2],
+                          [&](auto& data, int n) { vecops::clip(data[0], data[1], n, lo, hi); });
+    return *params[0];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemCopy(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // memCopy(dst, src, size, [dstStride], [srcStride])
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    const int size = toMemoryIndex(*params[2]);
+    const int dstStride = numParams > 3 ? toMemoryIndex(*params[3]) : 1;
+    const int srcStride = numParams > 4 ? toMemoryIndex(*params[4]) : 1;
+    if (size <= 0 || dstStride < 1 || srcStride < 1) {
+        return *params[0];
+    }
+    if (dstStride == 1 && srcStride == 1) {
+        // NOTE: the ranges may overlap, see memcpy()
+        MemoryRange dst(eel2Adapter, *params[0], size);
+        MemoryRange src(eel2Adapter, *params[1], size);
+        if (dst.data() && src.data()) {
+            std::memmove(dst.data(), src.data(), size * sizeof(double));
+            return *params[0];
+        }
+    }
+    MemoryRange dst(eel2Adapter, *params[0], (size - 1) * static_cast<double>(dstStride) + 1);
+    MemoryRange src(eel2Adapter, *params[1], (size - 1) * static_cast<double>(srcStride) + 1);
+    // copy backwards if the destination starts after the source, so that overlapping ranges
+    // are not overwritten before they are read (just like memmove())
+    const bool backwards = toMemoryIndex(*params[0]) > toMemoryIndex(*params[1]);
+    if (dst.data() && src.data()) {
+        // fast path: both ranges lie within a single memory block
+        auto d = dst.data();
+        auto s = src.data();
+        if (backwards) {
+            for (int i = size - 1; i >= 0; i--) {
+                d[i * dstStride] = s[i * srcStride];
+            }
+        } else {
+            for (int i = 0; i < size; i++) {
+                d[i * dstStride] = s[i * srcStride];
+            }
+        }
+    } else if (dst.valid() && src.valid()) {
+        if (backwards) {
+            for (int i = size - 1; i >= 0; i--) {
+                dst.set(i * dstStride, src.get(i * srcStride));
+            }
+        } else {
+            for (int i = 0; i < size; i++) {
+                dst.set(i * dstStride, src.get(i * srcStride));
+            }
+        }
+    }
+    return *params[0];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemMin(void* opaque, EEL_F* buf, EEL_F* size) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double result = std::numeric_limits<double>::infinity();
+    forEachMemoryChunk(eel2Adapter, *buf, *size,
+                       [&](double* data, int n) { result = std::min(result, vecops::min(data, n)); });
+    return std::isinf(result) ? 0.0 : result;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemMax(void* opaque, EEL_F* buf, EEL_F* size) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double result = -std::numeric_limits<double>::infinity();
+    forEachMemoryChunk(eel2Adapter, *buf, *size,
+                       [&](double* data, int n) { result = std::max(result, vecops::max(data, n)); });
+    return std::isinf(result) ? 0.0 : result;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemPeak(void* opaque, EEL_F* buf, EEL_F* size) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double result = 0.0;
+    forEachMemoryChunk(eel2Adapter, *buf, *size,
+                       [&](double* data, int n) { result = std::max(result, vecops::peak(data, n)); });
+    return result;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemRms(void* opaque, EEL_F* buf, EEL_F* size) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double sum = 0.0;
+    int count = 0;
+    forEachMemoryChunk(eel2Adapter, *buf, *size, [&](double* data, int n) {
+        sum += vecops::dot(data, data, n);
+        count += n;
+    });
+    return count > 0 ? std::sqrt(sum / count) : 0.0;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMemDot(void* opaque, EEL_F* a, EEL_F* b, EEL_F* size) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    double result = 0.0;
+    forEachMemoryChunk<2>(eel2Adapter, { *a, *b }, *size,
+                          [&](auto& data, int n) { result += vecops::dot(data[0], data[1], n); });
+    return result;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelMatMul(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // matMul(dst, matrix, src, rows, cols)
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    const int rows = toMemoryIndex(*params[3]);
+    const int cols = toMemoryIndex(*params[4]);
+    if (rows <= 0 || rows > matrixops::kMaxSize || cols <= 0 || cols > matrixops::kMaxSize) {
+        return *params[0];
+    }
+    // copy the vectors, so that the ranges may cross memory blocks and 'dst' may overlap with 'src'
+    double src[matrixops::kMaxSize];
+    double result[matrixops::kMaxSize];
+    if (readMemorySlots(eel2Adapter, *params[2], cols, src)
+        && matVecMemory(eel2Adapter, result, *params[1], src, rows, cols)) {
+        writeMemorySlots(eel2Adapter, *params[0], rows, result);
+    }
+    return *params[0];
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelHadamard(void* opaque, EEL_F* buf, EEL_F* size) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    const int n = toMemoryIndex(*size);
+    if (matrixops::isPowerOfTwo(n)) {
+        if (auto data = getMemorySlots(eel2Adapter, *buf, n)) {
+            matrixops::hadamard(data, n);
+        } else if (n <= matrixops::kMaxSize) {
+            // the range crosses a memory block
+            double temp[matrixops::kMaxSize];
+            if (readMemorySlots(eel2Adapter, *buf, n, temp)) {
+                matrixops::hadamard(temp, n);
+                writeMemorySlots(eel2Adapter, *buf, n, temp);
+            }
+        }
+    }
+    return *buf;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelHouseholder(void* opaque, EEL_F* buf, EEL_F* size) {
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    const int n = toMemoryIndex(*size);
+    if (n > 0) {
+        if (auto data = getMemorySlots(eel2Adapter, *buf, n)) {
+            matrixops::householder(data, n);
+        } else if (n <= matrixops::kMaxSize) {
+            // the range crosses a memory block
+            double temp[matrixops::kMaxSize];
+            if (readMemorySlots(eel2Adapter, *buf, n, temp)) {
+                matrixops::householder(temp, n);
+                writeMemorySlots(eel2Adapter, *buf, n, temp);
+            }
+        }
+    }
+    return *buf;
+}
+
+EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelFdnStep(void* opaque, const INT_PTR numParams, EEL_F** params) {
+    // fdnStep(writePos, buf, size, count, delays, gains, io, [matrix])
+    const auto eel2Adapter = static_cast<EEL2Adapter*>(opaque);
+    const int size = toMemoryIndex(*params[2]);
+    const int count = toMemoryIndex(*params[3]);
+    if (size <= 0 || count <= 0 || count > matrixops::kMaxSize) {
+        return 0.0;
+    }
+    // copy the vectors, so that they may cross memory blocks
+    double delays[matrixops::kMaxSize];
+    double gains[matrixops::kMaxSize];
+    double io[matrixops::kMaxSize];
+    if (!readMemorySlots(eel2Adapter, *params[4], count, delays)
+        || !readMemorySlots(eel2Adapter, *params[5], count, gains)
+        || !readMemorySlots(eel2Adapter, *params[6], count, io)) {
+        return 0.0;
+    }
+    // -1 = Householder (default), -2 = Hadamard, otherwise the memory index of a dense matrix.
+    // Other negative values and the Hadamard matrix with a non-power-of-two count are rejected.
+    const double matrixArg = numParams > 7 ? *params[7] : -1.0;
+    // NOTE: a dense matrix is read when mixing, before anything is written
+    if (matrixArg == -2.0) {
+        if (!matrixops::isPowerOfTwo(count)) {
+            return 0.0;
+        }
+    } else if (matrixArg < 0.0 && matrixArg != -1.0) {
+        return 0.0;
+    }
+
+    // the delay lines are stored one after the other
+    const MemoryRange first(eel2Adapter, *params[1], size);
+    if (!first.valid()) {
+        return 0.0;
+    }
+    int writePos;
+    double frac;
+    if (!first.split(*params[0], writePos, frac)) {
+        writePos = 0;
+    }
+
+    // read the delay lines with linear interpolation;
+    // a delay of N samples reads the sample that was written N samples ago
+    double outputs[matrixops::kMaxSize];
+    double feedback[matrixops::kMaxSize];
+    double sum = 0.0;
+    for (int k = 0; k < count; k++) {
+        const MemoryRange line(eel2Adapter, *params[1] + static_cast<double>(k) * size, size);
+        outputs[k] = line.valid() ? line.readL(writePos - delays[k]) : 0.0;
+        feedback[k] = outputs[k] * gains[k];
+        sum += outputs[k];
+    }
+    // mix
+    if (matrixArg >= 0.0) {
+        double mixed[matrixops::kMaxSize];
+        if (!matVecMemory(eel2Adapter, mixed, matrixArg, feedback, count, count)) {
+            return 0.0;
+        }
+        std::copy_n(mixed, count, feedback);
+    } else if (matrixArg == -2.0) {
+        matrixops::hadamard(feedback, count);
+    } else {
+        matrixops::householder(feedback, count);
+    }
+    // write back together with the inputs and return the delay outputs
+    for (int k = 0; k < count; k++) {
+        const MemoryRange line(eel2Adapter, *params[1] + static_cast<double>(k) * size, size);
+        if (line.valid()) {
+            line.set(writePos, io[k] + feedback[k]);
+        }
+    }
+    writeMemorySlots(eel2Adapter, *params[6], count, outputs);
+    *params[0] = (writePos + 1) % size;
+
+    return sum;
+}
+
 EEL_F NSEEL_CGEN_CALL EEL2Adapter::eelPrint(void*, const INT_PTR numParams, EEL_F** params) {
     std::array<char, 16384> buffer;
 
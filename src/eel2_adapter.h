@@ -8,11 +8,16 @@
 #include <SC_Wire.h>
 #include <SC_World.h>
 
+#include "arena.h"
 #include "library.h"
 #include "dyngen_script.h"
+#include "oversampler.h"
+#include "wavetable.h"
 
 #include <algorithm>
+#include <cmath>
 #include <memory>
+#include <vector>
 
 /*! @class EEL2Adapter
  *  @brief wraps a EEL2 VM and injects special functions and variables
@@ -33,6 +38,34 @@ public:
     /*! @brief returns true if vm has been compiled successfully */
     bool init(const DynGenScript& script, const int* parameterIndices, int numParamIndices);
 
+    /*! @brief runs the @prepare section (if any) with the given initial parameter values.
+     *  'parameterValues' matches the parameter indices passed to init().
+     *  This is not RT safe and is typically called in the NRT thread right after init()!
+     *  The section runs without the unit, so buffers, wavetables and done actions are not available.
+     */
+    void prepare(const float* parameterValues);
+
+    /*! @brief compiles and runs the @static section of the script in a temporary vm
+     *  and stores the resulting memory and variables in 'data'.
+     *  Returns false on failure. This is not RT safe!
+     */
+    static bool evalStatic(const DynGenScript& script, DynGenStaticData& data, World* world);
+
+    /*! @brief checks if the given function library compiles. This is not RT safe! */
+    static bool tryCompileLibrary(const DynGenFunctionLibrary& library);
+
+    /*! @brief sets an existing variable of the script; returns false if the variable does not exist.
+     *  With lanes, the variable is set in every lane.
+     */
+    bool setVariable(const char* name, double value);
+
+    /*! @brief returns a pointer to the memory of the VM at the given offset, or NULL
+     *  if the offset is out of range. 'numValid' receives the number of contiguous values
+     *  that can be accessed through the pointer.
+     *  NOTE: just like memory accesses in the script, this allocates memory blocks on demand.
+     */
+    double* getMemory(int offset, int& numValid) const { return NSEEL_VM_getramptr(mEelState, offset, &numValid); }
+
     static EEL_F eelBufRead(void* opaque, INT_PTR numParams, EEL_F** params);
     static EEL_F eelBufReadL(void* opaque, INT_PTR numParams, EEL_F** params);
     static EEL_F eelBufReadC(void* opaque, INT_PTR numParams, EEL_F** params);
@@ -40,6 +73,7 @@ public:
     static EEL_F eelBufSampleRate(void* opaque, EEL_F* bufNum);
     static EEL_F eelBufFrames(void* opaque, EEL_F* bufNum);
     static EEL_F eelBufChannels(void* opaque, EEL_F* bufNum);
+    static EEL_F eelWavetable(void* opaque, EEL_F* bufNum, EEL_F* phase, EEL_F* increment);
 
     static EEL_F eelSetDone(void* opaque, EEL_F* done);
     static EEL_F eelDoneAction(void* opaque, EEL_F* doneAction);
@@ -54,15 +88,58 @@ public:
     static EEL_F eelLininterp(void*, EEL_F* x, EEL_F* a, EEL_F* b);
     static EEL_F eelCubicinterp(void*, INT_PTR numParams, EEL_F** params);
 
+    static EEL_F eelFastSin(void*, EEL_F* x);
+    static EEL_F eelFastCos(void*, EEL_F* x);
+    static EEL_F eelFastExp2(void*, EEL_F* x);
+    static EEL_F eelFastLog2(void*, EEL_F* x);
+    static EEL_F eelFastTanh(void*, EEL_F* x);
+    static EEL_F eelFastSoftclip(void*, EEL_F* x);
+
     static EEL_F eelDelta(void*, EEL_F* state, EEL_F* signal);
     static EEL_F eelHistory(void*, EEL_F* state, EEL_F* signal);
     static EEL_F eelLatch(void*, EEL_F* state, EEL_F* signal, EEL_F* trigger);
 
+    static EEL_F eelOnePole(void* opaque, EEL_F* state, EEL_F* signal, EEL_F* coef);
+    static EEL_F eelOnePoleCoef(void* opaque, EEL_F* freq);
+    static EEL_F eelDcBlock(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelBiquad(void* opaque, EEL_F* state, EEL_F* signal, EEL_F* coefs);
+    static EEL_F eelBiquadLP(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q);
+    static EEL_F eelBiquadHP(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q);
+    static EEL_F eelBiquadBP(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q);
+    static EEL_F eelBiquadNotch(void* opaque, EEL_F* coefs, EEL_F* freq, EEL_F* q);
+    static EEL_F eelSvf(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelOnePoleBlock(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelDcBlockBlock(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelBiquadBlock(void* opaque, INT_PTR numParams, EEL_F** params);
+
+    static EEL_F eelMemReadL(void* opaque, EEL_F* buf, EEL_F* size, EEL_F* pos);
+    static EEL_F eelMemReadC(void* opaque, EEL_F* buf, EEL_F* size, EEL_F* pos);
+    static EEL_F eelMemReadA(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelDelayWrite(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelDelayRead(void* opaque, INT_PTR numParams, EEL_F** params);
+
+    static EEL_F eelMemAdd(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelMemMul(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelMemMac(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelMemScale(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelMemClip(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelMemCopy(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelMemMin(void* opaque, EEL_F* buf, EEL_F* size);
+    static EEL_F eelMemMax(void* opaque, EEL_F* buf, EEL_F* size);
+    static EEL_F eelMemPeak(void* opaque, EEL_F* buf, EEL_F* size);
+    static EEL_F eelMemRms(void* opaque, EEL_F* buf, EEL_F* size);
+    static EEL_F eelMemDot(void* opaque, EEL_F* a, EEL_F* b, EEL_F* size);
+
+    static EEL_F eelMatMul(void* opaque, INT_PTR numParams, EEL_F** params);
+    static EEL_F eelHadamard(void* opaque, EEL_F* buf, EEL_F* size);
+    static EEL_F eelHouseholder(void* opaque, EEL_F* buf, EEL_F* size);
+    static EEL_F eelFdnStep(void* opaque, INT_PTR numParams, EEL_F** params);
+
     static EEL_F eelPrint(void*, INT_PTR numParams, EEL_F** params);
     static EEL_F_PTR eelPrintMem(EEL_F** blocks, EEL_F* start, EEL_F* length);
     static EEL_F eelPoll(void* opaque, INT_PTR numParams, EEL_F** params);
 
-    void process(float** inBuf, float** outBuf, Wire** parameterPairs, int numSamples) {
+    void process(Wire** inputs, float** outBuf, Wire** parameterPairs, int numSamples) {
         double* newParamValues = nullptr;
         if (mNumParameters > 0) {
             // Copy new parameter values to the stack. Let's do this for *all* parameters, not only
@@ -76,6 +153,75 @@ public:
             }
         }
 
+        if (mOversampler) {
+            processOversampled(inputs, outBuf, parameterPairs, newParamValues, numSamples);
+        } else if (mNumLanes > 1) {
+            processLanes(inputs, outBuf, parameterPairs, newParamValues, numSamples);
+        } else {
+            processLane(inputs, outBuf, parameterPairs, newParamValues, mPrevInputValues, numSamples, false);
+        }
+
+        // NOTE: do this after *all* lanes have been processed!
+        if (mHasBlockTaps) {
+            writeTaps(TapRate::Block);
+        }
+
+        // Update the parameter cache. Although the parameter cache is only used by certain parameter
+        // types and rates, let's do it for *all* parameters because it's a simply memcpy().
+        std::copy_n(newParamValues, mNumParameters, mPrevParamValues);
+
+        mBlockCounter++;
+    }
+
+    /*! @brief upsamples the audio rate inputs and parameters, processes the lane(s)
+     *  at the higher sample rate and downsamples the outputs, see DynGenScript::mOversample.
+     */
+    void processOversampled(Wire** inputs, float** outBuf, Wire** parameterPairs, double* newParamValues,
+                            int numSamples);
+
+    /*! @brief processes all lanes one after the other, see DynGenScript::mNumLanes.
+     *  Before processing a lane, we load its variables into the VM and save them afterwards.
+     */
+    void processLanes(Wire** inputs, float** outBuf, Wire** parameterPairs, double* newParamValues, int numSamples);
+
+    /*! @brief processes a single lane; 'prevInputValues' is the input cache of the lane.
+     *  If 'accumulate' is true, the output is added to the output buffers.
+     *  NOTE: 'newParamValues' might be updated for audio rate "trig" parameters!
+     */
+    void processLane(Wire** inputs, float** outBuf, Wire** parameterPairs, double* newParamValues,
+                     double* prevInputValues, int numSamples, bool accumulate) {
+        // Sort the inputs by rate. Audio rate inputs are read for every sample; control rate
+        // inputs are interpolated linearly over the block, just like K2A; scalar inputs are held.
+        auto audioInputs = static_cast<InputUpdate*>(alloca(mNumInputChannels * sizeof(InputUpdate)));
+        auto otherInputs = static_cast<InputUpdate*>(alloca(mNumInputChannels * sizeof(InputUpdate)));
+        int numAudioInputs = 0, numOtherInputs = 0;
+        bool hasInputRamps = false;
+        for (int inChannel = 0; inChannel < mNumInputChannels; inChannel++) {
+            Wire* wire = inputs[inChannel];
+            double* var = mInputs[inChannel];
+            if (wire->mCalcRate == calc_FullRate) {
+                audioInputs[numAudioInputs++] = { var, wire->mBuffer, 0.0, 0.0 };
+            } else {
+                double value = static_cast<double>(wire->mBuffer[0]);
+                double prevValue = mBlockCounter > 0 ? prevInputValues[inChannel] : value;
+                // only control rate inputs can change
+                double slope = (value - prevValue) / static_cast<double>(numSamples);
+                otherInputs[numOtherInputs++] = { var, nullptr, prevValue, slope };
+                prevInputValues[inChannel] = value;
+                hasInputRamps |= slope != 0.0;
+            }
+        }
+        // copy input samples to in0, in1, etc. variables
+        auto updateInputs = [&](int i) {
+            for (int k = 0; k < numAudioInputs; k++) {
+                *audioInputs[k].var = static_cast<double>(audioInputs[k].buffer[i]);
+            }
+            for (int k = 0; k < numOtherInputs; k++) {
+                // the last sample reaches the new value, see K2A
+                *otherInputs[k].var = otherInputs[k].start + otherInputs[k].slope * (i + 1);
+            }
+        };
+
         // "init triggers" are "trig" parameters with a positive default value that are not modulated.
         // They should trigger exactly once on the very first sample. The variable pointers come right
         // after the modulated parameter variables.
@@ -105,15 +251,15 @@ public:
                         // We must initialize the parameter cache for "lin" parameters so that they
                         // immediately start with the initial value.
                         mPrevParamValues[i] = newParamValues[i];
+                        // "lag" parameters should not glide from zero
+                        mLagState[i] = newParamValues[i];
                     }
                 }
             }
 
             if (mInitCode) {
                 // initialize in0, in1, etc. variables to first input sample
-                for (int inChannel = 0; inChannel < mNumInputChannels; inChannel++) {
-                    *mInputs[inChannel] = static_cast<double>(inBuf[inChannel][0]);
-                }
+                updateInputs(0);
                 // "init triggers" start with a positive value
                 for (int i = 0; i < mNumInitTriggers; ++i) {
                     *initTriggers[i] = 1.0;
@@ -128,14 +274,12 @@ public:
             // Copy previous parameter values on the stack so they are not reloaded from memory.
             // IMPORTANT: do this *after* we have initialized the cache on the first block!
             prevParamValues = static_cast<double*>(alloca(mNumParameters * sizeof(double)));
-            std::copy_n(mPrevParamValues.get(), mNumParameters, prevParamValues);
+            std::copy_n(mPrevParamValues, mNumParameters, prevParamValues);
         }
 
         if (mBlockCode) {
             // update in0, in1, etc. variables to first input sample
-            for (int inChannel = 0; inChannel < mNumInputChannels; inChannel++) {
-                *mInputs[inChannel] = static_cast<double>(inBuf[inChannel][0]);
-            }
+            updateInputs(0);
 
             // Update parameters, but do *not* update the cache!
             //
@@ -172,119 +316,273 @@ public:
             NSEEL_code_execute(mBlockCode);
         }
 
-        double slopeFactor = 1.0 / static_cast<double>(numSamples);
+        if (!mTaps.empty()) {
+            // NOTE: do this after the @block section so it can change the buffer numbers
+            resolveTaps();
+        }
 
-        for (int i = 0; i < numSamples; i++) {
-            // update "sampleNum" variable
-            *mSampleNum = static_cast<double>(i);
+        // Sort the parameters by the kind of per-sample update *before* the sample loop,
+        // so that we do not have to dispatch on the parameter type and rate for every sample.
+        ParamUpdate* audioParams = nullptr; // audio rate
+        ParamUpdate* audioTriggers = nullptr; // audio rate "trig" parameters
+        ParamUpdate* rampParams = nullptr; // control rate "lin" parameters which have changed
+        ParamUpdate* expParams = nullptr; // control rate "exp" parameters which have changed
+        ParamUpdate* lagParams = nullptr; // audio or control rate "lag" parameters which have not settled yet
+        ParamUpdate* holdParams = nullptr; // control rate parameters which are simply reset on every sample
+        double** firedTriggers = nullptr; // control or init rate "trig" parameters that trigger on the first sample
+        int numAudioParams = 0, numAudioTriggers = 0, numRampParams = 0, numExpParams = 0, numLagParams = 0,
+            numHoldParams = 0, numFiredTriggers = 0;
 
-            // copy input samples to in0, in1, etc. variables
-            for (int inChannel = 0; inChannel < mNumInputChannels; inChannel++) {
-                *mInputs[inChannel] = static_cast<double>(inBuf[inChannel][i]);
-            }
+        if (mNumParameters > 0) {
+            auto paramUpdates = static_cast<ParamUpdate*>(alloca(mNumParameters * 6 * sizeof(ParamUpdate)));
+            audioParams = paramUpdates;
+            audioTriggers = paramUpdates + mNumParameters;
+            rampParams = paramUpdates + mNumParameters * 2;
+            expParams = paramUpdates + mNumParameters * 3;
+            lagParams = paramUpdates + mNumParameters * 4;
+            holdParams = paramUpdates + mNumParameters * 5;
+            firedTriggers = static_cast<double**>(alloca(mNumParameters * sizeof(double*)));
+
+            double slopeFactor = 1.0 / static_cast<double>(numSamples);
 
-            // update automated parameters.
             for (int paramNum = 0; paramNum < mNumParameters; paramNum++) {
-                if (double* param = mParameters[paramNum]) {
-                    auto type = mParameterTypes[paramNum];
-                    if (type == ParamType::Const) {
-                        // do not update "const" parameters!
-                        continue;
-                    }
+                double* param = mParameters[paramNum];
+                auto type = mParameterTypes[paramNum];
+                if (!param || type == ParamType::Const) {
+                    // do not update "const" parameters!
+                    continue;
+                }
 
-                    Wire* wire = parameterPairs[paramNum * 2 + 1];
-                    if (wire->mCalcRate == calc_FullRate) {
-                        // 1. audio rate
-                        double value = static_cast<double>(wire->mBuffer[i]);
-                        if (type == ParamType::Trigger) {
-                            // "trig" parameter -> convert SC-style trigger to (stateless)
-                            // single-sample trigger signal
-                            if (value > 0.0 && prevParamValues[paramNum] <= 0.0) {
-                                *param = 1.0;
-                            } else {
-                                *param = 0.0;
-                            }
-                            // Update the parameter cache!
-                            prevParamValues[paramNum] = value;
-                            // 'newParamValues' will be copied *unconditionally* to 'mPrevParamValues'
-                            // at the end of the process() function! This makes the update very cheap.
-                            // Actually, we'd only have to update our 'newParamValues' entry on the
-                            // last sample in the block, but this way we avoid yet another branch.
-                            newParamValues[paramNum] = value;
-                        } else {
-                            *param = value;
-                        }
-                    } else if (wire->mCalcRate == calc_BufRate) {
-                        // 2. control rate
-                        if (type == ParamType::Trigger) {
-                            // "trig" parameter -> convert SC-style trigger to (stateless) single-sample
-                            // trigger signal.
-                            // Only check the first sample in the block because the remaining samples
-                            // are guaranteed to be zero.
-                            if (i == 0 && newParamValues[paramNum] > 0.0 && prevParamValues[paramNum] <= 0.0) {
-                                *param = 1.0;
-                            } else {
-                                *param = 0.0;
-                            }
-                        } else if (type == ParamType::Linear) {
-                            // "lin" parameter -> ramp to new value if it has changed
-                            double newValue = newParamValues[paramNum];
-                            double prevValue = prevParamValues[paramNum];
-                            if (newValue != prevValue) {
-                                double slope = (newValue - prevValue) * slopeFactor;
-                                *param = prevValue + slope * i;
-                            } else {
-                                *param = newValue;
-                            }
-                        } else {
-                            // "step" parameter -> just set it as is.
-                            // (Actually, we only need to do this for the first sample in the block,
-                            // but repeatedly setting the variable might be cheaper than a branch.)
-                            *param = newParamValues[paramNum];
+                Wire* wire = parameterPairs[paramNum * 2 + 1];
+                double newValue = newParamValues[paramNum];
+                double prevValue = prevParamValues[paramNum];
+                if (wire->mCalcRate == calc_FullRate) {
+                    // 1. audio rate
+                    if (type == ParamType::Trigger) {
+                        audioTriggers[numAudioTriggers++] = { param, wire->mBuffer, paramNum, 0.0 };
+                    } else if (type == ParamType::Lag) {
+                        lagParams[numLagParams++] = { param, wire->mBuffer, paramNum, mLagCoefs[paramNum],
+                                                      mLagState[paramNum] };
+                    } else {
+                        audioParams[numAudioParams++] = { param, wire->mBuffer, paramNum, 0.0 };
+                    }
+                } else if (wire->mCalcRate == calc_BufRate) {
+                    // 2. control rate
+                    if (type == ParamType::Trigger) {
+                        // "trig" parameter -> convert SC-style trigger to (stateless) single-sample
+                        // trigger signal.
+                        // Only check the first sample in the block because the remaining samples
+                        // are guaranteed to be zero.
+                        holdParams[numHoldParams++] = { param, nullptr, paramNum, 0.0 };
+                        if (newValue > 0.0 && prevValue <= 0.0) {
+                            firedTriggers[numFiredTriggers++] = param;
                         }
+                    } else if (type == ParamType::Exponential && newValue != prevValue && newValue * prevValue > 0.0) {
+                        // "exp" parameter -> ramp to new value with a constant ratio between samples
+                        double ratio = std::pow(newValue / prevValue, slopeFactor);
+                        expParams[numExpParams++] = { param, nullptr, paramNum, ratio, prevValue };
+                    } else if ((type == ParamType::Linear || type == ParamType::Exponential) && newValue != prevValue) {
+                        // "lin" parameter, or "exp" parameter that crosses zero -> ramp to new value
+                        double slope = (newValue - prevValue) * slopeFactor;
+                        rampParams[numRampParams++] = { param, nullptr, paramNum, slope };
+                    } else if (type == ParamType::Lag && newValue != mLagState[paramNum]) {
+                        // "lag" parameter -> filter towards new value
+                        lagParams[numLagParams++] = { param, nullptr, paramNum, mLagCoefs[paramNum],
+                                                      mLagState[paramNum] };
                     } else {
-                        // 3. init rate
-                        if (type == ParamType::Trigger) {
-                            // only check the very first sample
-                            if (mSampleCounter == 0 && newParamValues[paramNum] > 0.0) {
-                                *param = 1.0;
-                            } else {
-                                *param = 0.0;
-                            }
+                        // "step" parameter or "lin"/"exp"/"lag" parameter that has not changed or settled
+                        // -> just set it as is.
+                        // (Actually, we only need to do this for the first sample in the block, but we
+                        // want to overwrite any changes made by the script, just like the other types.)
+                        holdParams[numHoldParams++] = { param, nullptr, paramNum, newValue };
+                    }
+                } else {
+                    // 3. init rate
+                    if (type == ParamType::Trigger) {
+                        // only check the very first sample
+                        holdParams[numHoldParams++] = { param, nullptr, paramNum, 0.0 };
+                        if (mSampleCounter == 0 && newValue > 0.0) {
+                            firedTriggers[numFiredTriggers++] = param;
                         }
-                        // We don't need to do anything for "lin" and "step" parameters.
                     }
+                    // We don't need to do anything for the other parameter types.
                 }
             }
-            // "init triggers" are only positive on the very first sample
+        }
+
+        // A stateless @sample section always produces the same output for the same inputs.
+        // If none of the inputs change within this block, we only have to execute it once.
+        // NOTE: "init triggers" can only fire on the very first sample.
+        if (mSampleStateless && !mHasSampleTaps && mSampleCounter > 0 && numAudioTriggers == 0 && numRampParams == 0
+            && numExpParams == 0 && numLagParams == 0 && numFiredTriggers == 0 && !hasInputRamps
+            && isConstantBlock(audioInputs, numAudioInputs, audioParams, numAudioParams, numSamples)) {
+            // update "sampleNum" variable
+            *mSampleNum = static_cast<double>(numSamples - 1);
+
+            updateInputs(0);
+            for (int k = 0; k < numAudioParams; k++) {
+                *audioParams[k].param = static_cast<double>(audioParams[k].buffer[0]);
+            }
+            for (int k = 0; k < numHoldParams; k++) {
+                *holdParams[k].param = holdParams[k].value;
+            }
             for (int i = 0; i < mNumInitTriggers; ++i) {
-                *initTriggers[i] = mSampleCounter == 0 ? 1.0 : 0.0;
+                *initTriggers[i] = 0.0;
             }
 
             NSEEL_code_execute(mSampleCode);
 
-            // copy out0, out1, etc. variables to output buffer.
             for (int outChannel = 0; outChannel < mNumOutputChannels; outChannel++) {
-                outBuf[outChannel][i] = static_cast<float>(*mOutputs[outChannel]);
-                // clear the variable so it never contains garbage from previous iterations.
+                auto value = static_cast<float>(*mOutputs[outChannel]);
+                if (accumulate) {
+                    for (int i = 0; i < numSamples; i++) {
+                        outBuf[outChannel][i] += value;
+                    }
+                } else {
+                    std::fill_n(outBuf[outChannel], numSamples, value);
+                }
                 *mOutputs[outChannel] = 0.0;
             }
 
-            mSampleCounter++;
-        }
+            mSampleCounter += numSamples;
+        } else {
+            for (int i = 0; i < numSamples; i++) {
+                // update "sampleNum" variable
+                *mSampleNum = static_cast<double>(i);
 
-        // Update the parameter cache. Although the parameter cache is only used by certain parameter
-        // types and rates, let's do it for *all* parameters because it's a simply memcpy().
-        std::copy_n(newParamValues, mNumParameters, mPrevParamValues.get());
+                updateInputs(i);
 
-        mBlockCounter++;
+                // update automated parameters.
+                for (int k = 0; k < numAudioParams; k++) {
+                    *audioParams[k].param = static_cast<double>(audioParams[k].buffer[i]);
+                }
+                for (int k = 0; k < numAudioTriggers; k++) {
+                    // "trig" parameter -> convert SC-style trigger to (stateless)
+                    // single-sample trigger signal
+                    auto paramNum = audioTriggers[k].index;
+                    double value = static_cast<double>(audioTriggers[k].buffer[i]);
+                    *audioTriggers[k].param = (value > 0.0 && prevParamValues[paramNum] <= 0.0) ? 1.0 : 0.0;
+                    // Update the parameter cache!
+                    prevParamValues[paramNum] = value;
+                    // 'newParamValues' will be copied *unconditionally* to 'mPrevParamValues'
+                    // at the end of the process() function! This makes the update very cheap.
+                    // Actually, we'd only have to update our 'newParamValues' entry on the
+                    // last sample in the block, but this way we avoid yet another branch.
+                    newParamValues[paramNum] = value;
+                }
+                for (int k = 0; k < numRampParams; k++) {
+                    *rampParams[k].param = prevParamValues[rampParams[k].index] + rampParams[k].value * i;
+                }
+                for (int k = 0; k < numExpParams; k++) {
+                    *expParams[k].param = expParams[k].state;
+                    expParams[k].state *= expParams[k].value;
+                }
+                for (int k = 0; k < numLagParams; k++) {
+                    // one-pole lowpass filter, see Lag UGen
+                    auto& lag = lagParams[k];
+                    double target = lag.buffer ? static_cast<double>(lag.buffer[i]) : newParamValues[lag.index];
+                    lag.state = target + lag.value * (lag.state - target);
+                    *lag.param = lag.state;
+                }
+                for (int k = 0; k < numHoldParams; k++) {
+                    *holdParams[k].param = holdParams[k].value;
+                }
+                if (i == 0) {
+                    for (int k = 0; k < numFiredTriggers; k++) {
+                        *firedTriggers[k] = 1.0;
+                    }
+                }
+                // "init triggers" are only positive on the very first sample
+                for (int k = 0; k < mNumInitTriggers; ++k) {
+                    *initTriggers[k] = mSampleCounter == 0 ? 1.0 : 0.0;
+                }
+
+                NSEEL_code_execute(mSampleCode);
+
+                if (mHasSampleTaps) {
+                    // NOTE: do this before clearing the output variables
+                    writeTaps(TapRate::Sample);
+                }
+
+                // copy out0, out1, etc. variables to output buffer.
+                for (int outChannel = 0; outChannel < mNumOutputChannels; outChannel++) {
+                    if (accumulate) {
+                        outBuf[outChannel][i] += static_cast<float>(*mOutputs[outChannel]);
+                    } else {
+                        outBuf[outChannel][i] = static_cast<float>(*mOutputs[outChannel]);
+                    }
+                    // clear the variable so it never contains garbage from previous iterations.
+                    *mOutputs[outChannel] = 0.0;
+                }
+
+                mSampleCounter++;
+            }
+        }
+
+        // save the filter state of "lag" parameters
+        for (int k = 0; k < numLagParams; k++) {
+            mLagState[lagParams[k].index] = lagParams[k].state;
+        }
     }
 
 private:
+    /*! @brief a per-sample parameter update, see process() */
+    struct ParamUpdate {
+        double* param;
+        /*! @brief the input buffer for audio rate parameters */
+        const float* buffer;
+        int index;
+        /*! @brief the constant value, resp. the slope for "lin" parameters, the ratio for
+         *  "exp" parameters or the filter coefficient for "lag" parameters.
+         */
+        double value;
+        /*! @brief the running value of "exp" and "lag" parameters */
+        double state;
+    };
+
+    /*! @brief a per-sample input update, see process() */
+    struct InputUpdate {
+        double* var;
+        /*! @brief the input buffer for audio rate inputs */
+        const float* buffer;
+        /*! @brief the previous value and slope for control rate inputs */
+        double start;
+        double slope;
+    };
+
+    /*! @brief checks if all audio rate inputs and parameters are constant within the block */
+    static bool isConstantBlock(const InputUpdate* audioInputs, int numAudioInputs, const ParamUpdate* audioParams,
+                                int numAudioParams, int numSamples) {
+        auto isConstant = [numSamples](const float* buf) {
+            return std::all_of(buf + 1, buf + numSamples, [first = buf[0]](float x) { return x == first; });
+        };
+        for (int k = 0; k < numAudioInputs; k++) {
+            if (!isConstant(audioInputs[k].buffer)) {
+                return false;
+            }
+        }
+        for (int k = 0; k < numAudioParams; k++) {
+            if (!isConstant(audioParams[k].buffer)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     NSEEL_VMCTX mEelState = nullptr;
+    NSEEL_CODEHANDLE mPrepareCode = nullptr;
     NSEEL_CODEHANDLE mInitCode = nullptr;
     NSEEL_CODEHANDLE mBlockCode = nullptr;
     NSEEL_CODEHANDLE mSampleCode = nullptr;
+    /*! @brief the imported function libraries; we keep the code handles
+     *  alive because the functions might be referenced by the other sections.
+     */
+    std::vector<NSEEL_CODEHANDLE> mImportCode;
+
+    /*! @brief compiles the function libraries imported by the script.
+     *  'getCode' may transform the code before compilation, see ConstantInliner.
+     */
+    template <typename GetCode> bool compileImports(const DynGenScript& script, GetCode&& getCode);
 
     int mNumInputChannels = 0;
     int mNumOutputChannels = 0;
@@ -298,24 +596,91 @@ private:
 
     double* mBlockNum = nullptr;
     double* mSampleNum = nullptr;
-    std::unique_ptr<double*[]> mInputs;
-    std::unique_ptr<double*[]> mOutputs;
-    std::unique_ptr<double*[]> mParameters;
-    std::unique_ptr<ParamType[]> mParameterTypes;
-    std::unique_ptr<double[]> mPrevParamValues;
+    /*! @brief owns the following arrays, so that we only need a single allocation */
+    Arena mArena;
+    double** mInputs = nullptr;
+    double** mOutputs = nullptr;
+    double** mParameters = nullptr;
+    ParamType* mParameterTypes = nullptr;
+    double* mPrevParamValues = nullptr;
+    double* mPrevInputValues = nullptr;
+    /*! @brief the filter coefficients and states of "lag" parameters */
+    double* mLagCoefs = nullptr;
+    double* mLagState = nullptr;
+    /*! @brief written by out() for out-of-range channels */
+    double mNullOutput = 0.0;
 
     World* mWorld;
     Unit* mUnit;
 
+    /*! @brief keeps the memory of the @static section alive while we are using it */
+    std::shared_ptr<DynGenStaticData> mStaticData;
+
+    /*! @brief a tap declared in the script, see TapSpec */
+    struct Tap {
+        /*! @brief a tapped variable or memory range */
+        struct Source {
+            /*! @brief the variable, or NULL for memory ranges */
+            double* variable;
+            int memStart;
+            int count;
+            /*! @brief points to the variable or the memory range, or is NULL if the
+             *  memory has not been allocated yet. Resolved at the start of each block.
+             */
+            const double* data;
+        };
+        std::vector<Source> sources;
+        /*! @brief the variable holding the buffer number, or NULL if the buffer number is constant */
+        double* bufNumVar = nullptr;
+        int bufNum = -1;
+        /*! @brief receives the current write position; may be NULL */
+        double* position = nullptr;
+        TapRate rate = TapRate::Sample;
+        /*! @brief resolved at the start of each block; NULL if the buffer is not available */
+        SndBuf* buf = nullptr;
+        int writePos = 0;
+    };
+
+    std::vector<Tap> mTaps;
+    bool mHasSampleTaps = false;
+    bool mHasBlockTaps = false;
+
+    /*! @brief set if the @sample section is stateless, see isStatelessSection() */
+    bool mSampleStateless = false;
+
+    int mNumLanes = 1;
+    bool mSumLanes = false;
+    /*! @brief the "lane" variable */
+    double* mLane = nullptr;
+    /*! @brief all variables of the VM */
+    std::vector<double*> mLaneVars;
+    /*! @brief the variables of every lane, see processLanes() */
+    std::unique_ptr<double[]> mLaneState;
+
+    /*! @brief resamples the inputs and outputs; NULL if the script is not oversampled */
+    std::unique_ptr<Oversampler> mOversampler;
+
+    /*! @brief creates the taps declared in the script; returns false on failure */
+    bool initTaps(const DynGenScript& script);
+
+    /*! @brief resolves the buffers and memory ranges of all taps for the current block */
+    void resolveTaps();
+
+    /*! @brief writes a frame into the ring buffer of every tap with the given rate */
+    void writeTaps(TapRate rate);
+
     /*! @brief cache the latest sndbuf b/c it is likely that we
      * stick to one sndbuf
      */
     SndBuf* mSndBuf = nullptr;
     int mSndBufNum = -1;
 
-    /*! @brief see GET_BUF macro from SC_Unit.h */
+    /*! @brief see GET_BUF macro from SC_Unit.h
+     *  NOTE: buffers are only available with a unit, i.e. not in the @static and @prepare
+     *  sections, because the buffers are owned by the RT thread.
+     */
     SndBuf* getBuffer(int bufNum) {
-        if (bufNum < 0) {
+        if (bufNum < 0 || !mUnit) {
             return nullptr;
         }
 
@@ -329,7 +694,7 @@ private:
 
         if (bufNum < mWorld->mNumSndBufs) {
             mSndBuf = mWorld->mSndBufs + bufNum;
-        } else {
+        } else if (mUnit) {
             // looking for a matching localbuf
             int localBufNum = bufNum - mWorld->mNumSndBufs;
             // NOTE: 'localMaxBufNum' actually holds the max. number of local
@@ -343,6 +708,38 @@ private:
         return mSndBuf;
     }
 
+    /*! @brief cache the latest wavetable, just like the sndbuf */
+    const Wavetable* mWavetable = nullptr;
+    int mWavetableBufNum = -1;
+    uint32_t mWavetableGeneration = 0;
+    /*! @brief the block in which the wavetable has been checked against the buffer data */
+    uint64_t mWavetableCheckBlock = std::numeric_limits<uint64_t>::max();
+    bool mWavetableValid = false;
+
+    /*! @brief returns the wavetable for the given buffer, or NULL if it does not exist or
+     *  if it has not been built from the current buffer data. The buffer must be locked!
+     */
+    const Wavetable* getWavetable(int bufNum, const SndBuf* buf) {
+        // the registry is RT only, see getBuffer()
+        if (!mUnit) {
+            return nullptr;
+        }
+        // NOTE: the cache is also invalidated whenever a wavetable has been (re)built
+        auto generation = wavetableGeneration();
+        if (bufNum != mWavetableBufNum || generation != mWavetableGeneration) {
+            mWavetable = findWavetable(bufNum);
+            mWavetableBufNum = bufNum;
+            mWavetableGeneration = generation;
+            mWavetableCheckBlock = std::numeric_limits<uint64_t>::max();
+        }
+        // the buffer data might change at any time, but only check once per block
+        if (mWavetable && mWavetableCheckBlock != mBlockCounter) {
+            mWavetableValid = mWavetable->matches(buf->data, buf->frames, buf->channels);
+            mWavetableCheckBlock = mBlockCounter;
+        }
+        return mWavetableValid ? mWavetable : nullptr;
+    }
+
     /*! @brief Assumes that chan is within bounds and that the buffer is locked */
     static float getSample(const SndBuf* buf, int chan, int frameIndex) {
         if (frameIndex >= 0 && frameIndex < buf->frames) {
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*! @file fast_math.h
+ *  @brief fast approximations of transcendental functions for audio signals.
+ *
+ *  @discussion The approximations trade the full double precision of libm for speed.
+ *  Since DynGen outputs single precision floats, the errors are kept below
+ *  the float epsilon (~6e-8) within the documented input range. They are
+ *  exposed to scripts as fsin(), fcos(), fexp2(), flog2(), ftanh() and fsoftclip(),
+ *  see EEL2Adapter::setup().
+ */
+namespace fastmath {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kLn2 = 0.69314718055994530942;
+constexpr double kLog2e = 1.44269504088896340736;
+
+/*! @brief returns 2^n for an integer n in the range [-1022, 1023] */
+inline double pow2i(int n) {
+    uint64_t bits = static_cast<uint64_t>(n + 1023) << 52;
+    double result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/*! @brief rounds to the nearest integer without branches; much faster than std::nearbyint().
+ *  Adding 1.5 * 2^52 pushes the fractional part out of the mantissa, so that the low bits
+ *  hold the rounded integer. Only valid for |x| < 2^51!
+ */
+inline int64_t roundToInt(double x) {
+    constexpr double kMagic = 6755399441055744.0; // 1.5 * 2^52
+    double y = x + kMagic;
+    int64_t bits;
+    std::memcpy(&bits, &y, sizeof(bits));
+    return bits - 0x4338000000000000ll;
+}
+
+/*! @brief sine and cosine for x in [-pi/4, pi/4] (Cephes sinf/cosf coefficients) */
+inline double sinKernel(double x) {
+    double x2 = x * x;
+    return x + x * x2 * (-1.6666654611e-1 + x2 * (8.3321608736e-3 + x2 * -1.9515295891e-4));
+}
+
+inline double cosKernel(double x) {
+    double x2 = x * x;
+    return 1.0 - 0.5 * x2
+        + x2 * x2 * (4.166664568298827e-2 + x2 * (-1.388731625493765e-3 + x2 * 2.443315711809948e-5));
+}
+
+/*! @brief max. absolute error ~3e-9 for |x| < 1e6; the error grows with |x|
+ *  because of the range reduction. Only valid for |x| < 2^51!
+ */
+inline double sin(double x) {
+    // reduce to [-pi/4, pi/4] and select the quadrant
+    auto q = roundToInt(x * (2.0 / kPi));
+    double r = x - static_cast<double>(q) * (kPi * 0.5);
+    switch (q & 3) {
+    case 0:
+        return sinKernel(r);
+    case 1:
+        return cosKernel(r);
+    case 2:
+        return -sinKernel(r);
+    default:
+        return -cosKernel(r);
+    }
+}
+
+/*! @brief see fastmath::sin() */
+inline double cos(double x) {
+    auto q = roundToInt(x * (2.0 / kPi));
+    double r = x - static_cast<double>(q) * (kPi * 0.5);
+    switch (q & 3) {
+    case 0:
+        return cosKernel(r);
+    case 1:
+        return -sinKernel(r);
+    case 2:
+        return -cosKernel(r);
+    default:
+        return sinKernel(r);
+    }
+}
+
+/*! @brief max. relative error ~1e-8. The input is clamped to [-1022, 1023],
+ *  so the result is always a normal number. NaN is treated as -1022.
+ */
+inline double exp2(double x) {
+    // NOTE: std::max() returns the first argument if the second argument is NaN
+    x = std::min(std::max(-1022.0, x), 1023.0);
+    // 2^x = 2^n * e^(f * ln2) with f in [-0.5, 0.5]
+    auto n = roundToInt(x);
+    double y = (x - static_cast<double>(n)) * kLn2;
+    // Taylor series up to y^7, |y| <= 0.347
+    double p = 1.0
+        + y * (1.0 + y * (1.0 / 2 + y * (1.0 / 6 + y * (1.0 / 24 + y * (1.0 / 120 + y * (1.0 / 720 + y / 5040))))));
+    return p * pow2i(static_cast<int>(n));
+}
+
+/*! @brief max. absolute error ~1e-9 for positive normal numbers.
+ *  Other values (zero, negative numbers, denormals, infinity and NaN) are passed to std::log2().
+ */
+inline double log2(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    int exponent = static_cast<int>(bits >> 52) - 1023;
+    if (exponent <= -1023 || exponent >= 1024) {
+        // zero, negative numbers, denormals, infinity or NaN
+        return std::log2(x);
+    }
+    // mantissa in [1, 2)
+    bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+    double m;
+    std::memcpy(&m, &bits, sizeof(m));
+    // move the mantissa to [sqrt(0.5), sqrt(2)) for faster convergence
+    if (m > 1.41421356237309504880) {
+        m *= 0.5;
+        exponent++;
+    }
+    // log(m) = 2 * atanh(t) with t = (m - 1) / (m + 1), |t| <= 0.172
+    double t = (m - 1.0) / (m + 1.0);
+    double t2 = t * t;
+    double s = t * (2.0 + t2 * (2.0 / 3 + t2 * (2.0 / 5 + t2 * (2.0 / 7 + t2 * (2.0 / 9)))));
+    return exponent + s * kLog2e;
+}
+
+/*! @brief max. absolute error ~5e-9 */
+inline double tanh(double x) {
+    if (x > 20.0) {
+        return 1.0;
+    } else if (x < -20.0) {
+        return -1.0;
+    } else if (std::abs(x) < 1e-3) {
+        // avoid cancellation; the next term is 2/15 x^5
+        return x - x * x * x * (1.0 / 3);
+    }
+    double e = exp2(x * (2.0 * kLog2e));
+    return (e - 1.0) / (e + 1.0);
+}
+
+/*! @brief cubic soft clipper: smooth saturation that reaches +/-1 at x = +/-1.
+ *  This is exact (no approximation) and much cheaper than tanh().
+ */
+inline double softclip(double x) {
+    if (x <= -1.0) {
+        return -1.0;
+    } else if (x >= 1.0) {
+        return 1.0;
+    } else {
+        return 1.5 * x - 0.5 * x * x * x;
+    }
+}
+
+} // namespace fastmath
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cmath>
+
+/*! @file filters.h
+ *  @brief basic filters for the filter functions of DynGen scripts, see EEL2Adapter::setup().
+ *
+ *  @discussion The filters do not own their state. Instead, the caller passes a pointer to
+ *  the state variables, which live in the memory of the script. This way every instance
+ *  and every lane of a script can have its own filter state without any allocation.
+ */
+namespace filters {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/*! @brief number of state variables, resp. coefficients */
+constexpr int kOnePoleState = 1;
+constexpr int kDcBlockState = 2;
+constexpr int kBiquadState = 2;
+constexpr int kBiquadCoefs = 5;
+constexpr int kSvfState = 2;
+
+/*! @brief one-pole lowpass filter, see OnePole UGen: y[n] = x[n] + coef * (y[n-1] - x[n]) */
+inline double onePole(double* state, double x, double coef) {
+    double y = x + coef * (state[0] - x);
+    state[0] = y;
+    return y;
+}
+
+/*! @brief returns the coefficient of a one-pole lowpass filter with the given cutoff frequency */
+inline double onePoleCoef(double freq, double sampleRate) { return std::exp(-2.0 * kPi * freq / sampleRate); }
+
+/*! @brief DC blocker, see LeakDC UGen: y[n] = x[n] - x[n-1] + coef * y[n-1] */
+inline double dcBlock(double* state, double x, double coef) {
+    double y = x - state[0] + coef * state[1];
+    state[0] = x;
+    state[1] = y;
+    return y;
+}
+
+/*! @brief biquad filter in transposed direct form II.
+ *  The coefficients are [b0, b1, b2, a1, a2], normalized by a0.
+ */
+inline double biquad(double* state, double x, const double* coefs) {
+    double y = coefs[0] * x + state[0];
+    state[0] = coefs[1] * x - coefs[3] * y + state[1];
+    state[1] = coefs[2] * x - coefs[4] * y;
+    return y;
+}
+
+enum class BiquadType { Lowpass, Highpass, Bandpass, Notch };
+
+/*! @brief computes the biquad coefficients for the given filter type,
+ *  see "Cookbook formulae for audio EQ biquad filter coefficients" by Robert Bristow-Johnson.
+ *  The bandpass filter has a constant peak gain of 0 dB.
+ */
+inline void biquadCoefs(double* coefs, BiquadType type, double freq, double q, double sampleRate) {
+    double w0 = 2.0 * kPi * freq / sampleRate;
+    double cosw0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * q);
+    double b0, b1, b2;
+    switch (type) {
+    case BiquadType::Lowpass:
+        b0 = b2 = (1.0 - cosw0) * 0.5;
+        b1 = 1.0 - cosw0;
+        break;
+    case BiquadType::Highpass:
+        b0 = b2 = (1.0 + cosw0) * 0.5;
+        b1 = -(1.0 + cosw0);
+        break;
+    case BiquadType::Bandpass:
+        b0 = alpha;
+        b1 = 0.0;
+        b2 = -alpha;
+        break;
+    default: // notch
+        b0 = b2 = 1.0;
+        b1 = -2.0 * cosw0;
+        break;
+    }
+    double a0 = 1.0 + alpha;
+    coefs[0] = b0 / a0;
+    coefs[1] = b1 / a0;
+    coefs[2] = b2 / a0;
+    coefs[3] = -2.0 * cosw0 / a0;
+    coefs[4] = (1.0 - alpha) / a0;
+}
+
+enum class SvfMode { Lowpass, Bandpass, Highpass, Notch };
+
+/*! @brief trapezoidal state variable filter, see "Linear Trapezoidal Integrated SVF"
+ *  by Andrew Simper. Unlike the biquad, it can be modulated at audio rate.
+ */
+inline double svf(double* state, double x, double freq, double q, SvfMode mode, double sampleRate) {
+    double g = std::tan(kPi * freq / sampleRate);
+    double k = 1.0 / q;
+    double a1 = 1.0 / (1.0 + g * (g + k));
+    double a2 = g * a1;
+    double a3 = g * a2;
+    double v3 = x - state[1];
+    double v1 = a1 * state[0] + a2 * v3;
+    double v2 = state[1] + a2 * state[0] + a3 * v3;
+    state[0] = 2.0 * v1 - state[0];
+    state[1] = 2.0 * v2 - state[1];
+    switch (mode) {
+    case SvfMode::Lowpass:
+        return v2;
+    case SvfMode::Bandpass:
+        return v1;
+    case SvfMode::Highpass:
+        return x - k * v1 - v2;
+    default: // notch
+        return x - k * v1;
+    }
+}
+
+} // namespace filters
@@ -1,9 +1,19 @@
 #include "library.h"
 #include "dyngen.h"
 #include "dyngen_script.h"
+#include "eel2_adapter.h"
+#include "string_utils.h"
+#include "wavetable.h"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 //-------------------- CodeLibrary --------------------//
 
@@ -30,7 +40,7 @@ void CodeLibrary::removeUnit(DynGen* unit) {
     }
 }
 
-bool CodeLibrary::isReadyToBeFreed() const { return mShouldBeFreed && mDynGen == nullptr; }
+bool CodeLibrary::isReadyToBeFreed() const { return mShouldBeFreed && mDynGen == nullptr && mNumPendingUpdates == 0; }
 
 //--------------------- Library ----------------------//
 
@@ -38,6 +48,22 @@ bool CodeLibrary::isReadyToBeFreed() const { return mShouldBeFreed && mDynGen ==
 // and its associated running DynGens.
 CodeLibrary* gLibrary = nullptr;
 
+/*! @brief an unfinished chunked upload, see Library::beginUploadCallback */
+struct PendingUpload {
+    std::string code;
+    size_t numBytesReceived = 0;
+    uint32_t checksum = 0;
+};
+
+/*! @brief unfinished uploads by script hash - NRT owned */
+std::unordered_map<int, PendingUpload> gPendingUploads;
+
+/*! @brief the registered function libraries by name - NRT owned */
+std::unordered_map<std::string, std::shared_ptr<const DynGenFunctionLibrary>> gFunctionLibraries;
+
+/*! @brief the max. size of an uploaded script; the size is announced by the client, so we better check it! */
+constexpr int kMaxUploadSize = 16 * 1024 * 1024;
+
 CodeLibrary* Library::getCode(World* world, int codeID) {
     auto code = findCode(codeID);
     if (!code) {
@@ -52,6 +78,10 @@ CodeLibrary* Library::getCode(World* world, int codeID) {
         code->mDynGen = nullptr;
         code->mScript = nullptr;
         code->mShouldBeFreed = false;
+        code->mNumPendingUpdates = 0;
+        code->mContentHash = 0;
+        // the node is allocated with RTAlloc(), so we have to construct the atomic ourselves
+        new (&code->mGeneration) std::atomic<uint32_t>(0);
         gLibrary = code;
     }
     return code;
@@ -92,10 +122,11 @@ void Library::freeNode(CodeLibrary* node, bool async) {
     // this should not be accessed b/c mShouldbeFreed has been set, but just to be safe
     node->mScript = nullptr;
 
-    // if no dyngen instance is associated with this script anymore,
-    // we can safely delete it. This gets also checked in
-    // the destructor of DynGen, so eventually it will be freed.
-    if (node->mDynGen == nullptr) {
+    // if no dyngen instance is associated with this script anymore
+    // and no updates are pending, we can safely delete it. This gets
+    // also checked in the destructor of DynGen and at the end of script
+    // updates, so eventually it will be freed.
+    if (node->isReadyToBeFreed()) {
         RTFree(world, node);
     }
 
@@ -116,73 +147,109 @@ void Library::freeNode(CodeLibrary* node, bool async) {
     }
 }
 
-void Library::buildGenericPayload(World* inWorld, sc_msg_iter* args, const bool isFile) {
-    auto newLibraryEntry = static_cast<NewDynGenLibraryEntry*>(RTAlloc(inWorld, sizeof(NewDynGenLibraryEntry)));
-    if (!newLibraryEntry) {
-        Print("ERROR: Failed to allocate memory for DynGen library entry\n");
-        return;
-    }
+bool Library::readEntry(World* inWorld, sc_msg_iter* args, NewDynGenLibraryEntry* newLibraryEntry, bool hasString) {
     // init pointers such that we can use generic cleanup method
     newLibraryEntry->oscString = nullptr;
     newLibraryEntry->numParameters = 0;
     newLibraryEntry->parameterNamesRT = nullptr;
+    newLibraryEntry->node = nullptr;
+    newLibraryEntry->script = nullptr;
     newLibraryEntry->oldScript = nullptr;
+    newLibraryEntry->deferSwap = false;
 
     newLibraryEntry->hash = args->geti();
 
-    if (const char* codePath = args->gets()) {
+    if (hasString) {
+        const char* codePath = args->gets();
+        if (!codePath) {
+            Print("ERROR: Invalid dyngenfile message\n");
+            releaseEntry(inWorld, newLibraryEntry);
+            return false;
+        }
         auto codePathLength = strlen(codePath) + 1;
         newLibraryEntry->oscString = static_cast<char*>(RTAlloc(inWorld, codePathLength));
         if (!newLibraryEntry->oscString) {
             Print("ERROR: Failed to allocate memory for DynGen code library\n");
-            rtCleanup(inWorld, newLibraryEntry, 0);
-            return;
+            releaseEntry(inWorld, newLibraryEntry);
+            return false;
         }
         std::copy_n(codePath, codePathLength, newLibraryEntry->oscString);
-    } else {
-        Print("ERROR: Invalid dyngenfile message\n");
-        rtCleanup(inWorld, newLibraryEntry, 0);
-        return;
     }
 
-    newLibraryEntry->numParameters = args->geti();
-    newLibraryEntry->parameterNamesRT = static_cast<char**>(RTAlloc(inWorld, newLibraryEntry->numParameters));
-    for (int i = 0; i < newLibraryEntry->numParameters; i++) {
+    auto numParameters = args->geti();
+    newLibraryEntry->parameterNamesRT = static_cast<char**>(RTAlloc(inWorld, sizeof(char*) * numParameters));
+    if (numParameters > 0 && !newLibraryEntry->parameterNamesRT) {
+        Print("ERROR: Failed to allocate memory for DynGen parameter names\n");
+        releaseEntry(inWorld, newLibraryEntry);
+        return false;
+    }
+    for (int i = 0; i < numParameters; i++) {
         if (const char* rawParam = args->gets()) {
             auto paramLength = strlen(rawParam) + 1;
             auto paramName = static_cast<char*>(RTAlloc(inWorld, paramLength));
             if (!paramName) {
                 Print("ERROR: Failed to allocate memory for DynGen parameter names\n");
-                rtCleanup(inWorld, newLibraryEntry, i - 1);
-                return;
+                releaseEntry(inWorld, newLibraryEntry);
+                return false;
             }
             std::copy_n(rawParam, paramLength, paramName);
             newLibraryEntry->parameterNamesRT[i] = paramName;
+            // only count the names we actually own
+            newLibraryEntry->numParameters = i + 1;
         } else {
             Print("ERROR: Invalid dyngenscript message of parameters\n");
-            rtCleanup(inWorld, newLibraryEntry, i - 1);
-            return;
+            releaseEntry(inWorld, newLibraryEntry);
+            return false;
         }
     }
 
-    auto [completionMsgSize, completionMsg] = getCompletionMsg(args);
+    // get/create the library entry and keep it alive until the command has finished.
+    newLibraryEntry->node = getCode(inWorld, newLibraryEntry->hash);
+    if (!newLibraryEntry->node) {
+        Print("ERROR: Failed to allocate memory for DynGen code library\n");
+        releaseEntry(inWorld, newLibraryEntry);
+        return false;
+    }
+    newLibraryEntry->node->mNumPendingUpdates += 1;
+    newLibraryEntry->generation = newLibraryEntry->node->mGeneration.fetch_add(1) + 1;
 
-    ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(newLibraryEntry),
-                               isFile ? loadFileToDynGenLibrary : loadScriptToDynGenLibrary, swapCode, deleteOldCode,
-                               pluginCmdCallbackCleanup, completionMsgSize, const_cast<char*>(completionMsg));
+    return true;
 }
 
-void Library::rtCleanup(World* inWorld, NewDynGenLibraryEntry* newLibraryEntry, int numRtParameters) {
-    if (newLibraryEntry == nullptr) {
-        return;
+void Library::releaseEntry(World* inWorld, NewDynGenLibraryEntry* newLibraryEntry) {
+    if (auto node = newLibraryEntry->node) {
+        // release the library entry
+        node->mNumPendingUpdates -= 1;
+        if (node->isReadyToBeFreed()) {
+            RTFree(inWorld, node);
+        }
     }
 
-    RTFree(inWorld, newLibraryEntry->oscString);
-    for (int j = 0; j < numRtParameters; j++) {
-        RTFree(inWorld, newLibraryEntry->parameterNamesRT[j]);
+    for (int i = 0; i < newLibraryEntry->numParameters; i++) {
+        RTFree(inWorld, newLibraryEntry->parameterNamesRT[i]);
     }
     RTFree(inWorld, newLibraryEntry->parameterNamesRT);
-    RTFree(inWorld, newLibraryEntry);
+    RTFree(inWorld, newLibraryEntry->oscString);
+}
+
+void Library::buildGenericPayload(World* inWorld, sc_msg_iter* args, const bool isFile, const bool deferSwap) {
+    auto newLibraryEntry = static_cast<NewDynGenLibraryEntry*>(RTAlloc(inWorld, sizeof(NewDynGenLibraryEntry)));
+    if (!newLibraryEntry) {
+        Print("ERROR: Failed to allocate memory for DynGen library entry\n");
+        return;
+    }
+
+    if (!readEntry(inWorld, args, newLibraryEntry)) {
+        RTFree(inWorld, newLibraryEntry);
+        return;
+    }
+    newLibraryEntry->deferSwap = deferSwap;
+
+    auto [completionMsgSize, completionMsg] = getCompletionMsg(args);
+
+    ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(newLibraryEntry),
+                               isFile ? loadFileToDynGenLibrary : loadScriptToDynGenLibrary, swapCode, deleteOldCode,
+                               pluginCmdCallbackCleanup, completionMsgSize, const_cast<char*>(completionMsg));
 }
 
 void Library::dyngenAddFileCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
@@ -193,12 +260,253 @@ void Library::addScriptCallback(World* inWorld, void* inUserData, sc_msg_iter* a
     buildGenericPayload(inWorld, args, false);
 }
 
+void Library::prepareScriptCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    buildGenericPayload(inWorld, args, false, true);
+}
+
+void Library::swapScriptCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    const auto codeId = args->geti();
+    const auto code = findCode(codeId);
+    if (code == nullptr) {
+        Print("ERROR: Could not swap DynGen script with ID %d: not found\n", codeId);
+        return;
+    }
+    // the sample offset of the (timed) OSC bundle within the next block
+    for (auto dynGen = code->mDynGen; dynGen != nullptr; dynGen = dynGen->mNextDynGen) {
+        dynGen->scheduleSwap(inWorld->mSampleOffset);
+    }
+}
+
+void Library::addFilesCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    auto numEntries = args->geti();
+    if (numEntries <= 0) {
+        Print("ERROR: Invalid dyngenfiles message\n");
+        return;
+    }
+
+    auto batchSize = sizeof(NewDynGenLibraryBatch) + sizeof(NewDynGenLibraryEntry) * numEntries;
+    auto batch = static_cast<NewDynGenLibraryBatch*>(RTAlloc(inWorld, batchSize));
+    if (!batch) {
+        Print("ERROR: Failed to allocate memory for DynGen library entries\n");
+        return;
+    }
+
+    for (int i = 0; i < numEntries; i++) {
+        if (!readEntry(inWorld, args, &batch->entries[i])) {
+            // release all entries we have read so far
+            for (int j = 0; j < i; j++) {
+                releaseEntry(inWorld, &batch->entries[j]);
+            }
+            RTFree(inWorld, batch);
+            return;
+        }
+    }
+    batch->numEntries = numEntries;
+
+    auto [completionMsgSize, completionMsg] = getCompletionMsg(args);
+
+    ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(batch), loadFilesToDynGenLibrary,
+                               swapCodeBatch, deleteOldCodeBatch, batchCallbackCleanup, completionMsgSize,
+                               const_cast<char*>(completionMsg));
+}
+
+DynGenUploadChunk* Library::allocUploadChunk(World* world, int hash, int dataSize) {
+    auto chunk = static_cast<DynGenUploadChunk*>(RTAlloc(world, sizeof(DynGenUploadChunk) + dataSize));
+    if (!chunk) {
+        Print("ERROR: Failed to allocate memory for DynGen upload\n");
+        return nullptr;
+    }
+    chunk->hash = hash;
+    chunk->offset = 0;
+    chunk->size = dataSize;
+    chunk->checksum = 0;
+    return chunk;
+}
+
+void Library::beginUploadCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    auto hash = args->geti();
+    auto totalSize = args->geti();
+    auto checksum = static_cast<uint32_t>(args->geti());
+    if (totalSize <= 0) {
+        Print("ERROR: Invalid dyngenupload message\n");
+        return;
+    }
+    if (totalSize > kMaxUploadSize) {
+        Print("ERROR: DynGen upload for script with hash %i is too large (%d bytes, max. %d bytes)\n", hash, totalSize,
+              kMaxUploadSize);
+        return;
+    }
+
+    if (auto chunk = allocUploadChunk(inWorld, hash, 0)) {
+        chunk->size = totalSize;
+        chunk->checksum = checksum;
+        ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(chunk), beginUpload, nullptr,
+                                   nullptr, uploadCallbackCleanup, 0, nullptr);
+    }
+}
+
+void Library::uploadChunkCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    auto hash = args->geti();
+    auto offset = args->geti();
+    auto data = args->gets();
+    if (!data || offset < 0) {
+        Print("ERROR: Invalid dyngenchunk message\n");
+        return;
+    }
+
+    auto dataSize = static_cast<int>(strlen(data));
+    if (auto chunk = allocUploadChunk(inWorld, hash, dataSize)) {
+        chunk->offset = offset;
+        std::copy_n(data, dataSize, chunk->data);
+        ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(chunk), uploadChunk, nullptr,
+                                   nullptr, uploadCallbackCleanup, 0, nullptr);
+    }
+}
+
+void Library::commitUploadCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    auto newLibraryEntry = static_cast<NewDynGenLibraryEntry*>(RTAlloc(inWorld, sizeof(NewDynGenLibraryEntry)));
+    if (!newLibraryEntry) {
+        Print("ERROR: Failed to allocate memory for DynGen library entry\n");
+        return;
+    }
+
+    // the code is already in the upload buffer
+    if (!readEntry(inWorld, args, newLibraryEntry, false)) {
+        RTFree(inWorld, newLibraryEntry);
+        return;
+    }
+
+    auto [completionMsgSize, completionMsg] = getCompletionMsg(args);
+
+    ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(newLibraryEntry),
+                               loadUploadToDynGenLibrary, swapCode, deleteOldCode, pluginCmdCallbackCleanup,
+                               completionMsgSize, const_cast<char*>(completionMsg));
+}
+
+void Library::addFunctionLibraryCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    auto name = args->gets();
+    auto code = args->gets();
+    if (!name || !code) {
+        Print("ERROR: Invalid dyngenlib message\n");
+        return;
+    }
+
+    auto nameSize = strlen(name) + 1;
+    auto codeSize = strlen(code) + 1;
+    auto payloadSize = sizeof(DynGenFunctionLibraryPayload) + nameSize + codeSize;
+    auto payload = static_cast<DynGenFunctionLibraryPayload*>(RTAlloc(inWorld, payloadSize));
+    if (!payload) {
+        Print("ERROR: Failed to allocate memory for DynGen function library\n");
+        return;
+    }
+    payload->codeOffset = static_cast<int>(nameSize);
+    std::copy_n(name, nameSize, payload->data);
+    std::copy_n(code, codeSize, payload->data + nameSize);
+
+    auto [completionMsgSize, completionMsg] = getCompletionMsg(args);
+
+    ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(payload), loadFunctionLibrary, nullptr,
+                               nullptr, uploadCallbackCleanup, completionMsgSize, const_cast<char*>(completionMsg));
+}
+
+bool Library::loadFunctionLibrary(World* world, void* rawCallbackData) {
+    auto payload = static_cast<DynGenFunctionLibraryPayload*>(rawCallbackData);
+    return addFunctionLibrary(payload->data, payload->data + payload->codeOffset);
+}
+
+bool Library::addFunctionLibrary(std::string name, std::string code) {
+    if (!isAlphaNumeric(name) || name.empty()) {
+        Print("ERROR: function library name '%s' is not alphanumeric\n", name.c_str());
+        return false;
+    }
+    auto library = std::make_shared<DynGenFunctionLibrary>();
+    library->name = std::move(name);
+    library->code = std::move(code);
+    // validate once, so that scripts do not fail because of broken libraries
+    if (!EEL2Adapter::tryCompileLibrary(*library)) {
+        return false;
+    }
+    gFunctionLibraries[library->name] = std::move(library);
+    return true;
+}
+
+std::shared_ptr<const DynGenFunctionLibrary> Library::findFunctionLibrary(std::string_view name) {
+    if (auto it = gFunctionLibraries.find(std::string(name)); it != gFunctionLibraries.end()) {
+        return it->second;
+    } else {
+        return nullptr;
+    }
+}
+
+void Library::addWavetableCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    if (args->nextTag('f') != 'i') {
+        Print("ERROR: Invalid dyngenwavetable message\n");
+        return;
+    }
+    auto bufNum = args->geti();
+    if (bufNum < 0 || bufNum >= static_cast<int>(inWorld->mNumSndBufs)) {
+        Print("ERROR: DynGen wavetable: buffer number %d out of range\n", bufNum);
+        return;
+    }
+
+    auto payload = static_cast<DynGenWavetablePayload*>(RTAlloc(inWorld, sizeof(DynGenWavetablePayload)));
+    if (!payload) {
+        Print("ERROR: Failed to allocate memory for DynGen wavetable\n");
+        return;
+    }
+    payload->bufNum = bufNum;
+    payload->table = nullptr;
+    payload->oldTable = nullptr;
+
+    auto [completionMsgSize, completionMsg] = getCompletionMsg(args);
+
+    ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(payload), buildWavetable, swapWavetable,
+                               deleteOldWavetable, uploadCallbackCleanup, completionMsgSize,
+                               const_cast<char*>(completionMsg));
+}
+
+bool Library::buildWavetable(World* world, void* rawCallbackData) {
+    auto payload = static_cast<DynGenWavetablePayload*>(rawCallbackData);
+    auto buf = World_GetNRTBuf(world, payload->bufNum);
+    if (!buf || !buf->data) {
+        Print("ERROR: DynGen wavetable: buffer %d has not been allocated\n", payload->bufNum);
+        return false;
+    }
+    auto frames = buf->frames;
+    if (frames < 4 || (frames & (frames - 1)) != 0) {
+        Print("ERROR: DynGen wavetable: the number of frames of buffer %d must be a power of two (got %d)\n",
+              payload->bufNum, frames);
+        return false;
+    }
+    payload->table = new Wavetable(payload->bufNum, buf->data, frames, buf->channels);
+    return true;
+}
+
+bool Library::swapWavetable(World* world, void* rawCallbackData) {
+    auto payload = static_cast<DynGenWavetablePayload*>(rawCallbackData);
+    payload->oldTable = installWavetable(payload->table);
+    return true;
+}
+
+bool Library::deleteOldWavetable(World* world, void* rawCallbackData) {
+    auto payload = static_cast<DynGenWavetablePayload*>(rawCallbackData);
+    delete payload->oldTable;
+    return true;
+}
+
 void Library::freeScriptCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
     if (args->nextTag('f') != 'i') {
         Print("Error: Invalid DynGenFree message\n");
         return;
     }
     const auto codeId = args->geti();
+
+    // also drop an unfinished upload for this script, see beginUploadCallback()
+    if (auto chunk = allocUploadChunk(inWorld, codeId, 0)) {
+        ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, static_cast<void*>(chunk), dropPendingUploads, nullptr,
+                                   nullptr, uploadCallbackCleanup, 0, nullptr);
+    }
+
     const auto code = findCode(codeId);
     if (code == nullptr) {
         Print("Error: Could not free DynGen script with ID %d: not found\n", codeId);
@@ -209,6 +517,8 @@ void Library::freeScriptCallback(World* inWorld, void* inUserData, sc_msg_iter*
 }
 
 void Library::freeAllScriptsCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr) {
+    ft->fDoAsynchronousCommand(inWorld, nullptr, nullptr, nullptr, dropPendingUploads, nullptr, nullptr, nullptr, 0,
+                               nullptr);
     while (gLibrary != nullptr) {
         freeNode(gLibrary, true);
     }
@@ -224,21 +534,71 @@ void Library::cleanup() {
         // free synchronously!
         freeNode(gLibrary, false);
     }
+    gPendingUploads.clear();
+    gFunctionLibraries.clear();
+    freeAllWavetables();
+}
+
+bool Library::isOutdated(const NewDynGenLibraryEntry* entry) {
+    return entry->generation != entry->node->mGeneration.load(std::memory_order_relaxed);
+}
+
+uint64_t Library::contentHash(std::string_view code, char** parameterNames, int numParameters,
+                              const std::vector<std::shared_ptr<const DynGenFunctionLibrary>>& imports) {
+    auto hash = hashString(code);
+    for (int i = 0; i < numParameters; i++) {
+        // include the separator so that moving characters between names changes the hash
+        hash = hashString(parameterNames[i], hashString(",", hash));
+    }
+    // replacing an imported function library must trigger a recompilation, even if the script itself did not change.
+    for (auto& library : imports) {
+        hash = hashString(library->code, hashString(";", hash));
+    }
+    return hash;
 }
 
-bool Library::loadCodeToDynGenLibrary(NewDynGenLibraryEntry* newLibraryEntry, std::string_view code) {
+bool Library::loadCodeToDynGenLibrary(World* world, NewDynGenLibraryEntry* newLibraryEntry, std::string_view code) {
+    // Drop the update if a newer version of the script is already queued.
+    // We still continue with the next stage so that the completion message will be performed.
+    if (isOutdated(newLibraryEntry)) {
+        newLibraryEntry->script = nullptr;
+        return true;
+    }
+
     auto script = std::make_unique<DynGenScript>();
 
     if (!script->parse(code, newLibraryEntry->parameterNamesRT, newLibraryEntry->numParameters)) {
         return false;
     }
 
+    // Skip scripts which have been sent again without any changes, e.g. by re-evaluating an Ndef.
+    // NOTE: mContentHash is NRT owned and the node is kept alive until the command has finished.
+    auto node = newLibraryEntry->node;
+    auto hash = contentHash(code, newLibraryEntry->parameterNamesRT, newLibraryEntry->numParameters, script->mImports);
+    if (hash == node->mContentHash) {
+        newLibraryEntry->script = nullptr;
+        return true;
+    }
+
     // already try to compile before creating/updating any DynGen instances.
     if (!script->tryCompile()) {
         return false;
     }
 
+    // evaluate the @static section once for all instances
+    if (!script->initStatic(world)) {
+        return false;
+    }
+
+    // a newer version might have arrived while we were compiling
+    if (isOutdated(newLibraryEntry)) {
+        newLibraryEntry->script = nullptr;
+        return true;
+    }
+
     newLibraryEntry->script = script.release();
+    // the script will be swapped in the next stage
+    node->mContentHash = hash;
 
     // continue with next stage
     return true;
@@ -247,12 +607,18 @@ bool Library::loadCodeToDynGenLibrary(NewDynGenLibraryEntry* newLibraryEntry, st
 bool Library::loadScriptToDynGenLibrary(World* world, void* rawCallbackData) {
     const auto entry = static_cast<NewDynGenLibraryEntry*>(rawCallbackData);
 
-    return loadCodeToDynGenLibrary(entry, entry->oscString);
+    return loadCodeToDynGenLibrary(world, entry, entry->oscString);
 }
 
 bool Library::loadFileToDynGenLibrary(World* world, void* rawCallbackData) {
     auto entry = static_cast<NewDynGenLibraryEntry*>(rawCallbackData);
 
+    if (isOutdated(entry)) {
+        // no need to read the file, see loadCodeToDynGenLibrary()
+        entry->script = nullptr;
+        return true;
+    }
+
     auto codeFile = std::ifstream(entry->oscString, std::ios::binary);
     if (!codeFile.is_open()) {
         Print("ERROR: Could not open DynGen file at %s\n", entry->oscString);
@@ -267,43 +633,158 @@ bool Library::loadFileToDynGenLibrary(World* world, void* rawCallbackData) {
     codeBuffer.resize(codeSize);
     codeFile.read(codeBuffer.data(), codeSize);
 
-    return loadCodeToDynGenLibrary(entry, codeBuffer);
+    return loadCodeToDynGenLibrary(world, entry, codeBuffer);
+}
+
+bool Library::beginUpload(World* world, void* rawCallbackData) {
+    auto chunk = static_cast<DynGenUploadChunk*>(rawCallbackData);
+    // replaces any unfinished upload for the same script
+    auto& upload = gPendingUploads[chunk->hash];
+    upload.code.assign(chunk->size, '\0');
+    upload.numBytesReceived = 0;
+    upload.checksum = chunk->checksum;
+    // we are done
+    return false;
+}
+
+bool Library::uploadChunk(World* world, void* rawCallbackData) {
+    auto chunk = static_cast<DynGenUploadChunk*>(rawCallbackData);
+    auto it = gPendingUploads.find(chunk->hash);
+    if (it == gPendingUploads.end()) {
+        Print("ERROR: Received DynGen chunk for script with hash %i without upload\n", chunk->hash);
+        return false;
+    }
+    auto& upload = it->second;
+    if (static_cast<size_t>(chunk->offset) + chunk->size > upload.code.size()) {
+        Print("ERROR: DynGen chunk for script with hash %i exceeds the announced size\n", chunk->hash);
+        return false;
+    }
+    std::copy_n(chunk->data, chunk->size, upload.code.data() + chunk->offset);
+    upload.numBytesReceived += chunk->size;
+    // we are done
+    return false;
+}
+
+bool Library::dropPendingUploads(World* world, void* rawCallbackData) {
+    if (auto chunk = static_cast<DynGenUploadChunk*>(rawCallbackData)) {
+        gPendingUploads.erase(chunk->hash);
+    } else {
+        gPendingUploads.clear();
+    }
+    // we are done
+    return false;
+}
+
+bool Library::loadUploadToDynGenLibrary(World* world, void* rawCallbackData) {
+    auto entry = static_cast<NewDynGenLibraryEntry*>(rawCallbackData);
+
+    auto it = gPendingUploads.find(entry->hash);
+    if (it == gPendingUploads.end()) {
+        Print("ERROR: Could not find DynGen upload for script with hash %i\n", entry->hash);
+        return false;
+    }
+    // take the code and remove the upload
+    auto upload = std::move(it->second);
+    gPendingUploads.erase(it);
+
+    // chunks might get lost or duplicated with UDP
+    if (upload.numBytesReceived != upload.code.size()) {
+        Print("ERROR: Incomplete DynGen upload for script with hash %i (received %zu of %zu bytes)\n", entry->hash,
+              upload.numBytesReceived, upload.code.size());
+        return false;
+    }
+    if (adler32(upload.code) != upload.checksum) {
+        Print("ERROR: Checksum mismatch in DynGen upload for script with hash %i\n", entry->hash);
+        return false;
+    }
+
+    return loadCodeToDynGenLibrary(world, entry, upload.code);
+}
+
+void Library::uploadCallbackCleanup(World* world, void* rawCallbackData) { RTFree(world, rawCallbackData); }
+
+bool Library::loadFilesToDynGenLibrary(World* world, void* rawCallbackData) {
+    auto batch = static_cast<NewDynGenLibraryBatch*>(rawCallbackData);
+
+    // Each script is parsed and compiled with its own EEL2 VMs, so we can safely
+    // process several entries in parallel. If the same hash appears several times,
+    // only the last entry will be processed, see isOutdated().
+    // NOTE: failed entries are simply skipped, they have already posted an error message.
+    std::atomic<int> nextEntry{0};
+    auto worker = [&]() {
+        int i;
+        while ((i = nextEntry.fetch_add(1)) < batch->numEntries) {
+            loadFileToDynGenLibrary(world, &batch->entries[i]);
+        }
+    };
+
+    auto numThreads = std::min<int>(std::max(1u, std::thread::hardware_concurrency()), batch->numEntries);
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (int i = 1; i < numThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    // the NRT thread participates as well
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // continue with next stage
+    return true;
+}
+
+bool Library::swapCodeBatch(World* world, void* rawCallbackData) {
+    auto batch = static_cast<NewDynGenLibraryBatch*>(rawCallbackData);
+    for (int i = 0; i < batch->numEntries; i++) {
+        swapCode(world, &batch->entries[i]);
+    }
+    return true;
+}
+
+bool Library::deleteOldCodeBatch(World* world, void* rawCallbackData) {
+    auto batch = static_cast<NewDynGenLibraryBatch*>(rawCallbackData);
+    for (int i = 0; i < batch->numEntries; i++) {
+        deleteOldCode(world, &batch->entries[i]);
+    }
+    return true;
 }
 
 bool Library::swapCode(World* world, void* rawCallbackData) {
     const auto entry = static_cast<NewDynGenLibraryEntry*>(rawCallbackData);
 
-    CodeLibrary* node = Library::findCode(entry->hash);
+    if (!entry->script) {
+        // the script has not changed, so there is nothing to do
+        return true;
+    }
 
-    if (!node) {
-        // create new code node
-        auto* newNode = static_cast<CodeLibrary*>(RTAlloc(world, sizeof(CodeLibrary)));
-        if (!newNode) {
+    CodeLibrary* node = entry->node;
+    if (node->mShouldBeFreed) {
+        // The script has been freed in the meantime, so we need a new entry.
+        // NOTE: the content hash of the new entry stays empty because it is NRT owned.
+        node = getCode(world, entry->hash);
+        if (!node) {
             Print("ERROR: Failed to allocate memory for new code library\n");
+            // delete the new script in the next stage
+            entry->oldScript = entry->script;
             return true;
         }
-        newNode->mNext = gLibrary;
-        newNode->mWorld = world;
-        newNode->mID = entry->hash;
-        newNode->mDynGen = nullptr;
-        newNode->mScript = entry->script;
-        newNode->mShouldBeFreed = false;
-        gLibrary = newNode;
-    } else {
-        // swap code
-        entry->oldScript = node->mScript;
-        node->mScript = entry->script;
-
-        for (auto dynGen = node->mDynGen; dynGen != nullptr; dynGen = dynGen->mNextDynGen) {
-            // although the code can be updated, the referenced code
-            // lives long enough b/c in worst case there is already
-            // a new code in the pipeline at stage2 where the old code
-            // would be destroyed in its stage4.
-            // Yet we only need to access the code in stage 2 in our callback,
-            // where it could not have been destroyed yet.
-            // See
-            // https://github.com/capital-G/DynGen/pull/40#discussion_r2599579920
-            // clang-format off
+    }
+
+    // swap code
+    entry->oldScript = node->mScript;
+    node->mScript = entry->script;
+
+    for (auto dynGen = node->mDynGen; dynGen != nullptr; dynGen = dynGen->mNextDynGen) {
+        // although the code can be updated, the referenced code
+        // lives long enough b/c in worst case there is already
+        // a new code in the pipeline at stage2 where the old code
+        // would be destroyed in its stage4.
+        // Yet we only need to access the code in stage 2 in our callback,
+        // where it could not have been destroyed yet.
+        // See
+        // https://github.com/capital-G/DynGen/pull/40#discussion_r2599579920
+        // clang-format off
 /*
      ┌─────────┐             ┌──────────┐           ┌─────────┐          ┌──────────┐
      │STAGE1_RT│             │STAGE2_NRT│           │STAGE3_RT│          │STAGE4_NRT│
@@ -364,9 +845,8 @@ STAGE3_RT -> STAGE4_NRT : deleteOldVm
 @enduml
 ```
 */
-            // clang-format on
-            dynGen->updateCode(entry->script);
-        }
+        // clang-format on
+        dynGen->updateCode(entry->script, entry->deferSwap);
     }
     return true;
 }
@@ -379,14 +859,18 @@ bool Library::deleteOldCode(World* world, void* rawCallbackData) {
 
 void Library::pluginCmdCallbackCleanup(World* world, void* rawCallbackData) {
     auto callBackData = static_cast<NewDynGenLibraryEntry*>(rawCallbackData);
-    for (int i = 0; i < callBackData->numParameters; i++) {
-        RTFree(world, callBackData->parameterNamesRT[i]);
-    }
-    RTFree(world, callBackData->parameterNamesRT);
-    RTFree(world, callBackData->oscString);
+    releaseEntry(world, callBackData);
     RTFree(world, callBackData);
 }
 
+void Library::batchCallbackCleanup(World* world, void* rawCallbackData) {
+    auto batch = static_cast<NewDynGenLibraryBatch*>(rawCallbackData);
+    for (int i = 0; i < batch->numEntries; i++) {
+        releaseEntry(world, &batch->entries[i]);
+    }
+    RTFree(world, batch);
+}
+
 std::pair<int, const char*> Library::getCompletionMsg(sc_msg_iter* args) {
     auto const completionMsgSize = static_cast<int>(args->getbsize());
     const char* completionMsg = nullptr;
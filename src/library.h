@@ -1,6 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
 
 // forward declarations
 struct CodeLibrary;
@@ -11,6 +16,7 @@ struct DynGenCallbackData;
 struct EEL2Adapter;
 struct InterfaceTable;
 struct Unit;
+class Wavetable;
 struct World;
 
 extern InterfaceTable* ft;
@@ -38,6 +44,10 @@ extern InterfaceTable* ft;
 struct DynGenStub {
     DynGen* mObject;
     size_t mRefCount;
+    /*! @brief incremented (RT) for every VM update of this DynGen, so that
+     *  outdated updates can be dropped in the NRT thread, see DynGen::createVmAndCompile
+     */
+    std::atomic<uint32_t> mGeneration;
 };
 
 /*! @brief Stores code and associated Dyngen instances
@@ -76,6 +86,25 @@ struct CodeLibrary {
      */
     bool mShouldBeFreed;
 
+    /*! @brief the number of script updates for this entry that are still in flight.
+     *  Since they hold a reference to this entry, it must not be freed before they
+     *  have finished. RT owned.
+     */
+    int mNumPendingUpdates;
+
+    /*! @brief the content hash (code plus parameter names) of the last script which
+     *  has been successfully loaded for this entry, or 0 if there is none. This allows
+     *  us to skip scripts which have been sent again without any changes. NRT owned.
+     */
+    uint64_t mContentHash;
+
+    /*! @brief incremented (RT) for every script update of this entry, so that
+     *  outdated updates can be dropped in the NRT thread before doing any work.
+     *  When a script gets re-sent several times in a row, only the newest version
+     *  gets compiled and swapped in.
+     */
+    std::atomic<uint32_t> mGeneration;
+
     /*! @brief register a DynGen unit for this code node */
     void addUnit(DynGen* unit);
 
@@ -97,8 +126,12 @@ struct DynGenCallbackData {
 
     /*! @brief the running dyngen stub to be updated */
     DynGenStub* dynGenStub;
+    /*! @brief the value of DynGenStub::mGeneration for this update */
+    uint32_t generation;
     /*! @brief the new script to be used */
     const DynGenScript* script;
+    /*! @brief if true, the new vm is only swapped in by DynGen::scheduleSwap() */
+    bool deferSwap;
 
     /*! @brief vm init */
     int numInputChannels;
@@ -118,6 +151,10 @@ struct DynGenCallbackData {
      * the indices as part of the command itself so we only hit the
      * RT memory allocator once. */
     int parameterIndices[1];
+    // NOTE: the initial parameter values for the @prepare section are stored
+    // right after the parameter indices, see DynGenCallbackData::parameterValues().
+
+    float* parameterValues() { return reinterpret_cast<float*>(parameterIndices + numParameters); }
 };
 
 /*! @brief The callback payload to enter a new entry into the code library,
@@ -127,6 +164,14 @@ struct NewDynGenLibraryEntry {
     /*! @brief while in sclang land we use strings to identify */
     int hash;
 
+    /*! @brief the library entry for the hash at the time the command has been
+     *  received. We hold a reference, see CodeLibrary::mNumPendingUpdates.
+     */
+    CodeLibrary* node;
+
+    /*! @brief the value of CodeLibrary::mGeneration for this update */
+    uint32_t generation;
+
     /*! @discussion This can hold 2 alternatives, both RT managed and 0 terminated
      *  Alternative A: read code from file
      *  absolute path to the file storing the DynGen code
@@ -145,11 +190,77 @@ struct NewDynGenLibraryEntry {
     char** parameterNamesRT;
     int numParameters;
 
-    /*! @brief the newly received script - NRT managed */
+    /*! @brief the newly received script - NRT managed.
+     *  This is NULL if the script has not changed, so there is nothing to update.
+     */
     DynGenScript* script;
 
     /*! @brief the code to be replaced and should be deleted - NRT managed */
     DynGenScript* oldScript;
+
+    /*! @brief if true, running DynGen instances only prepare their new VM
+     *  and wait for the swap command, see Library::prepareScriptCallback
+     */
+    bool deferSwap;
+};
+
+/*! @brief A named library of EEL2 functions which can be imported by scripts
+ *  with the @import directive. The code is shared by all scripts which import it,
+ *  so it stays alive even if the library is replaced. Read-only after creation.
+ */
+struct DynGenFunctionLibrary {
+    std::string name;
+    std::string code;
+};
+
+/*! @brief The callback payload for registering a function library,
+ *  see Library::addFunctionLibraryCallback
+ */
+struct DynGenFunctionLibraryPayload {
+    /*! @brief the offset of the code within data */
+    int codeOffset;
+    /*! @brief the library name and code as consecutive null-terminated strings */
+    char data[1];
+};
+
+/*! @brief The callback payload for building a wavetable,
+ *  see Library::addWavetableCallback
+ */
+struct DynGenWavetablePayload {
+    int bufNum;
+    /*! @brief the new wavetable - NRT managed */
+    Wavetable* table;
+    /*! @brief the wavetable to be replaced and deleted - NRT managed */
+    Wavetable* oldTable;
+};
+
+/*! @brief The callback payload for the chunked script upload,
+ *  see Library::beginUploadCallback and Library::uploadChunkCallback
+ */
+struct DynGenUploadChunk {
+    /*! @brief the script the upload belongs to */
+    int hash;
+    /*! @brief the byte offset of the chunk within the script */
+    int offset;
+    /*! @brief the size of the chunk, or the total size of the script
+     *  when beginning a new upload */
+    int size;
+    /*! @brief the Adler-32 checksum of the whole script, only used
+     *  when beginning a new upload */
+    uint32_t checksum;
+    /*! @brief the content of the chunk. We allocate the data as part
+     *  of the command itself, similar to DynGenCallbackData::parameterIndices */
+    char data[1];
+};
+
+/*! @brief The callback payload to enter several files into the code library
+ *  at once, see Library::addFilesCallback
+ */
+struct NewDynGenLibraryBatch {
+    int numEntries;
+    /*! @brief we allocate the entries as part of the command itself,
+     *  similar to DynGenCallbackData::parameterIndices */
+    NewDynGenLibraryEntry entries[1];
 };
 
 class Library {
@@ -175,6 +286,55 @@ public:
      */
     static void addScriptCallback(World* inWorld, void* inUserData, struct sc_msg_iter* args, void* replyAddr);
 
+    /*! @brief like `addScriptCallback`, but running DynGen instances only prepare their
+     *  new VM in the background and keep running the old one until the script is swapped
+     *  with `swapScriptCallback`. New DynGen instances immediately use the new script.
+     */
+    static void prepareScriptCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr);
+
+    /*! @brief swaps in the VMs prepared by `prepareScriptCallback` for all DynGen instances
+     *  of the given script. When sent in a timed OSC bundle, the swap happens at the exact
+     *  sample, see World::mSampleOffset. This runs synchronously on the RT thread.
+     */
+    static void swapScriptCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr);
+
+    /*! @brief like `dyngenAddFileCallback` but registers a whole list of files
+     *  within a single async command. The files are loaded and compiled in parallel
+     *  and all scripts are swapped in during the same RT stage.
+     *  The completion message is performed once after all scripts have been registered.
+     */
+    static void addFilesCallback(World* inWorld, void* inUserData, struct sc_msg_iter* args, void* replyAddr);
+
+    /*! @brief begins a chunked upload of a script which is too large to fit
+     *  into a single OSC message. This (pre-)allocates a NRT owned buffer for the
+     *  given script hash. A previous unfinished upload for the same hash is discarded.
+     */
+    static void beginUploadCallback(World* inWorld, void* inUserData, struct sc_msg_iter* args, void* replyAddr);
+
+    /*! @brief copies a chunk of a script into the upload buffer, see beginUploadCallback */
+    static void uploadChunkCallback(World* inWorld, void* inUserData, struct sc_msg_iter* args, void* replyAddr);
+
+    /*! @brief like `addScriptCallback` but takes the script from the upload buffer
+     *  after verifying its size and checksum.
+     */
+    static void commitUploadCallback(World* inWorld, void* inUserData, struct sc_msg_iter* args, void* replyAddr);
+
+    /*! @brief registers a named library of EEL2 functions which can then be
+     *  imported by scripts with the @import directive, see addFunctionLibrary().
+     *  Replacing a library does not affect running scripts, but any script which
+     *  imports it will be recompiled when it is sent again, even if it has not changed.
+     */
+    static void addFunctionLibraryCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr);
+
+    /*! @brief returns the function library with the given name or NULL. NRT only! */
+    static std::shared_ptr<const DynGenFunctionLibrary> findFunctionLibrary(std::string_view name);
+
+    /*! @brief builds a band-limited wavetable from the given buffer in the background,
+     *  which can then be read by scripts with the wavetable() function, see Wavetable.
+     *  The command must be sent again whenever the buffer content changes.
+     */
+    static void addWavetableCallback(World* inWorld, void* inUserData, sc_msg_iter* args, void* replyAddr);
+
     /*! @brief makes a script unavailable for new unit instances. Only when all
      *  running DynGen instances (see DynGenStub) are removed, it will also
      *  be removed from the library
@@ -191,6 +351,15 @@ private:
     /*! @brief find the CodeLibrary for a given code ID */
     static CodeLibrary* findCode(int codeID);
 
+    /*! @brief checks if a newer update for the same entry has been received in the meantime */
+    static bool isOutdated(const NewDynGenLibraryEntry* entry);
+
+    /*! @brief computes the content hash of a script, see CodeLibrary::mContentHash.
+     *  The imported function libraries are part of the content.
+     */
+    static uint64_t contentHash(std::string_view code, char** parameterNames, int numParameters,
+                                const std::vector<std::shared_ptr<const DynGenFunctionLibrary>>& imports);
+
     /*! @brief removes a node from the linked list and checks
      *  if any associated resources are ready to be freed.
      *
@@ -206,20 +375,29 @@ private:
      */
     static void freeNode(CodeLibrary* node, bool async);
 
-    /*! @brief unified abstraction layer for dynGenAddFileCallback and
-     *  addScriptCallback which preapres the payload for the async callback.
+    /*! @brief unified abstraction layer for dynGenAddFileCallback,
+     *  addScriptCallback and prepareScriptCallback which preapres the payload
+     *  for the async callback.
+     */
+    static void buildGenericPayload(World* inWorld, sc_msg_iter* args, bool isFile, bool deferSwap = false);
+
+    /*! @brief reads a single entry (hash, code/path, parameter names) from the
+     *  OSC message into the given (uninitialized) entry and acquires the
+     *  associated code library node. If 'hasString' is false, the message does
+     *  not contain code or a path, see commitUploadCallback().
+     *  On failure, all resources are released again and false is returned.
      */
-    static void buildGenericPayload(World* inWorld, sc_msg_iter* args, bool isFile);
+    static bool readEntry(World* inWorld, sc_msg_iter* args, NewDynGenLibraryEntry* newLibraryEntry,
+                          bool hasString = true);
 
-    /*! @brief performs all cleanup procedures in case RT Alloc of the
-     *  newLibraryEntry setup fails */
-    static void rtCleanup(World* inWorld, NewDynGenLibraryEntry* newLibraryEntry, int numRtParameters);
+    /*! @brief releases all RT resources of an entry, but not the entry itself */
+    static void releaseEntry(World* inWorld, NewDynGenLibraryEntry* newLibraryEntry);
 
     /*! @brief common function for loadScriptToDynGenLibrary() and
      * loadFileToDynGenLibrary() which creates and initializes the actual
      * DynGenScript instance.
      */
-    static bool loadCodeToDynGenLibrary(NewDynGenLibraryEntry* newLibraryEntry, std::string_view code);
+    static bool loadCodeToDynGenLibrary(World* world, NewDynGenLibraryEntry* newLibraryEntry, std::string_view code);
 
     /*! @brief this runs in stage 2 (NRT) and copies the content of the
      *  RT owned code to a NRT owned code
@@ -231,6 +409,49 @@ private:
      */
     static bool loadFileToDynGenLibrary(World* world, void* rawCallbackData);
 
+    /*! @brief this runs in stage 2 (NRT) and takes the code from the upload buffer */
+    static bool loadUploadToDynGenLibrary(World* world, void* rawCallbackData);
+
+    /*! @brief this runs in stage 2 (NRT) and creates a new upload buffer */
+    static bool beginUpload(World* world, void* rawCallbackData);
+
+    /*! @brief this runs in stage 2 (NRT) and copies a chunk into the upload buffer */
+    static bool uploadChunk(World* world, void* rawCallbackData);
+
+    /*! @brief this runs in stage 2 (NRT) and drops the unfinished upload for the given DynGenUploadChunk::hash,
+     *  or all unfinished uploads if the data is NULL
+     */
+    static bool dropPendingUploads(World* world, void* rawCallbackData);
+
+    /*! @brief allocates a DynGenUploadChunk with the given data size */
+    static DynGenUploadChunk* allocUploadChunk(World* world, int hash, int dataSize);
+
+    /*! @brief frees a DynGenUploadChunk on the RT thread */
+    static void uploadCallbackCleanup(World* world, void* rawCallbackData);
+
+    /*! @brief this runs in stage 2 (NRT) and compiles and registers a function library */
+    static bool loadFunctionLibrary(World* world, void* rawCallbackData);
+
+    /*! @brief registers a function library, replacing any existing library with the same name.
+     *  Returns false if the library does not compile. NRT only!
+     */
+    static bool addFunctionLibrary(std::string name, std::string code);
+
+    /*! @brief this runs in stage 2 (NRT) and builds the wavetable from the buffer */
+    static bool buildWavetable(World* world, void* rawCallbackData);
+
+    /*! @brief this runs in stage 3 (RT) and installs the new wavetable */
+    static bool swapWavetable(World* world, void* rawCallbackData);
+
+    /*! @brief this runs in stage 4 (NRT) and deletes the old wavetable */
+    static bool deleteOldWavetable(World* world, void* rawCallbackData);
+
+    /*! @brief this runs in stage 2 (NRT) and calls loadFileToDynGenLibrary()
+     *  for all entries of a NewDynGenLibraryBatch, distributed over several
+     *  worker threads.
+     */
+    static bool loadFilesToDynGenLibrary(World* world, void* rawCallbackData);
+
     /*! @brief runs in stage 3 (RT-thread)
      *
      *  @discussion The code string gets entered into the library
@@ -243,11 +464,20 @@ private:
     /*! @brief runs in stage 4 (non-RT-thread) */
     static bool deleteOldCode(World* world, void* rawCallbackData);
 
+    /*! @brief stage 3 (RT) of a batch, calls swapCode() for every entry */
+    static bool swapCodeBatch(World* world, void* rawCallbackData);
+
+    /*! @brief stage 4 (NRT) of a batch, calls deleteOldCode() for every entry */
+    static bool deleteOldCodeBatch(World* world, void* rawCallbackData);
+
     /*! @brief frees the created struct. Uses RTFree since the callback data has
      *  been allocated within RT thread
      */
     static void pluginCmdCallbackCleanup(World* world, void* rawCallbackData);
 
+    /*! @brief like pluginCmdCallbackCleanup() but for a NewDynGenLibraryBatch */
+    static void batchCallbackCleanup(World* world, void* rawCallbackData);
+
     /*! @brief a helper method to consume a completion message from the message
      *  stack makes completionMsg either a nullptr (no message) or point
      *  it to the buffer within the osc message.
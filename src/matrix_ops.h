@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cmath>
+
+/*! @file matrix_ops.h
+ *  @brief matrix kernels for the matrix and FDN functions of DynGen scripts, see EEL2Adapter::setup().
+ *
+ *  @discussion Matrices are stored in row-major order. Besides the dense matrix-vector product
+ *  there are two structured orthogonal matrices which are commonly used as the feedback matrix
+ *  of a feedback delay network (FDN): the Hadamard matrix costs O(N log N) and the Householder
+ *  reflection only O(N) operations, instead of O(N^2).
+ */
+namespace matrixops {
+
+/*! @brief max. number of rows resp. FDN lines */
+constexpr int kMaxSize = 256;
+
+/*! @brief dst = matrix * src, where 'matrix' has 'rows' rows and 'cols' columns.
+ *  'dst' must not overlap with 'src'!
+ */
+inline void matVec(double* dst, const double* matrix, const double* src, int rows, int cols) {
+    for (int r = 0; r < rows; r++) {
+        const double* row = matrix + r * cols;
+        double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+        int c = 0;
+        for (; c + 4 <= cols; c += 4) {
+            for (int k = 0; k < 4; k++) {
+                sum[k] += row[c + k] * src[c + k];
+            }
+        }
+        for (; c < cols; c++) {
+            sum[0] += row[c] * src[c];
+        }
+        dst[r] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+}
+
+inline bool isPowerOfTwo(int n) { return n > 0 && (n & (n - 1)) == 0; }
+
+/*! @brief in-place fast Walsh-Hadamard transform, normalized so that the transform is orthogonal
+ *  (energy preserving). 'n' must be a power of two.
+ */
+inline void hadamard(double* buf, int n) {
+    for (int len = 1; len < n; len <<= 1) {
+        for (int i = 0; i < n; i += len * 2) {
+            for (int k = i; k < i + len; k++) {
+                double a = buf[k];
+                double b = buf[k + len];
+                buf[k] = a + b;
+                buf[k + len] = a - b;
+            }
+        }
+    }
+    double scale = 1.0 / std::sqrt(static_cast<double>(n));
+    for (int i = 0; i < n; i++) {
+        buf[i] *= scale;
+    }
+}
+
+/*! @brief in-place Householder reflection I - 2/N * 1 * 1^T, which is orthogonal for any 'n' */
+inline void householder(double* buf, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += buf[i];
+    }
+    double offset = sum * 2.0 / n;
+    for (int i = 0; i < n; i++) {
+        buf[i] -= offset;
+    }
+}
+
+} // namespace matrixops
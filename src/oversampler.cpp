@@ -0,0 +1,165 @@
+#include "oversampler.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+//-------------------- helper functions -------------------//
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// number of non-zero coefficients on each side of the center tap
+constexpr int kNumTaps = HalfbandUpsampler::kLatency;
+// the upsampler needs the last 2 * kNumTaps - 1 input samples
+constexpr int kUpHistory = 2 * kNumTaps - 1;
+// the downsampler needs the last 4 * kNumTaps - 3 input samples
+constexpr int kDownHistory = 4 * kNumTaps - 3;
+
+/*! @brief returns the odd coefficients h[1], h[3], h[5], etc. of a Blackman-windowed
+ *  half-band filter with 4 * kNumTaps - 1 taps. The center tap is always 0.5 and
+ *  the filter is symmetric, i.e. h[-n] = h[n].
+ */
+const std::array<float, kNumTaps>& halfbandCoefficients() {
+    static const auto coefficients = [] {
+        std::array<double, kNumTaps> coefs;
+        double sum = 0.0;
+        for (int k = 0; k < kNumTaps; k++) {
+            double n = 2 * k + 1;
+            double sinc = std::sin(kPi * n * 0.5) / (kPi * n);
+            double x = kPi * n / (2 * kNumTaps);
+            double window = 0.42 + 0.5 * std::cos(x) + 0.08 * std::cos(2.0 * x);
+            coefs[k] = sinc * window;
+            sum += coefs[k];
+        }
+        // normalize for unity gain at DC: 0.5 + 2 * sum = 1
+        std::array<float, kNumTaps> result;
+        for (int k = 0; k < kNumTaps; k++) {
+            result[k] = static_cast<float>(coefs[k] * 0.25 / sum);
+        }
+        return result;
+    }();
+    return coefficients;
+}
+
+int numStages(int factor) {
+    int count = 0;
+    while (factor > 1) {
+        factor /= 2;
+        count++;
+    }
+    return count;
+}
+
+} // namespace
+
+//-------------------- HalfbandUpsampler -------------------//
+
+HalfbandUpsampler::HalfbandUpsampler(int maxNumSamples) : mBuffer(kUpHistory + maxNumSamples, 0.f) {
+    // compute the coefficients on the NRT thread
+    halfbandCoefficients();
+}
+
+void HalfbandUpsampler::process(const float* in, float* out, int numSamples) {
+    auto& coefs = halfbandCoefficients();
+    float* buf = mBuffer.data();
+    // NOTE: copy the input first because 'in' and 'out' may alias
+    std::copy_n(in, numSamples, buf + kUpHistory);
+    for (int i = 0; i < numSamples; i++) {
+        // x[0] is the center tap
+        const float* x = buf + kUpHistory + i - kNumTaps;
+        float sum = 0.f;
+        for (int k = 0; k < kNumTaps; k++) {
+            sum += coefs[k] * (x[-k] + x[k + 1]);
+        }
+        // compensate for the zero-stuffing
+        out[i * 2] = x[0];
+        out[i * 2 + 1] = 2.f * sum;
+    }
+    // keep the history for the next block
+    std::copy(buf + numSamples, buf + numSamples + kUpHistory, buf);
+}
+
+//-------------------- HalfbandDownsampler -------------------//
+
+HalfbandDownsampler::HalfbandDownsampler(int maxNumSamples) : mBuffer(kDownHistory + maxNumSamples * 2, 0.f) {
+    // compute the coefficients on the NRT thread
+    halfbandCoefficients();
+}
+
+void HalfbandDownsampler::process(const float* in, float* out, int numSamples) {
+    auto& coefs = halfbandCoefficients();
+    float* buf = mBuffer.data();
+    // NOTE: copy the input first because 'in' and 'out' may alias
+    std::copy_n(in, numSamples * 2, buf + kDownHistory);
+    for (int i = 0; i < numSamples; i++) {
+        // x[0] is the center tap
+        const float* x = buf + kDownHistory + i * 2 + 1 - (2 * kNumTaps - 1);
+        float sum = 0.5f * x[0];
+        for (int k = 0; k < kNumTaps; k++) {
+            sum += coefs[k] * (x[-2 * k - 1] + x[2 * k + 1]);
+        }
+        out[i] = sum;
+    }
+    // keep the history for the next block
+    std::copy(buf + numSamples * 2, buf + numSamples * 2 + kDownHistory, buf);
+}
+
+//-------------------- Oversampler -------------------//
+
+Oversampler::Oversampler(int factor, int numInputs, int numOutputs, int maxNumSamples) : mFactor(factor) {
+    assert(factor == 2 || factor == 4 || factor == 8);
+    auto count = numStages(factor);
+
+    mInputs.resize(numInputs);
+    for (auto& input : mInputs) {
+        // the first stage runs at the original sample rate
+        for (int i = 0; i < count; i++) {
+            input.stages.emplace_back(maxNumSamples << i);
+        }
+        input.buffer.resize(maxNumSamples * factor);
+    }
+
+    mOutputs.resize(numOutputs);
+    for (auto& output : mOutputs) {
+        // the first stage runs at the highest sample rate
+        for (int i = 0; i < count; i++) {
+            output.stages.emplace_back((maxNumSamples * factor) >> (i + 1));
+        }
+        output.buffer.resize(maxNumSamples * factor);
+    }
+}
+
+float* Oversampler::upsample(int input, const float* in, int numSamples) {
+    auto& [stages, buffer] = mInputs[input];
+    float* buf = buffer.data();
+    const float* src = in;
+    for (auto& stage : stages) {
+        stage.process(src, buf, numSamples);
+        src = buf;
+        numSamples *= 2;
+    }
+    return buf;
+}
+
+float* Oversampler::hold(int input, const float* in, int numSamples) {
+    float* buf = mInputs[input].buffer.data();
+    for (int i = 0; i < numSamples; i++) {
+        std::fill_n(buf + i * mFactor, mFactor, in[i]);
+    }
+    return buf;
+}
+
+void Oversampler::downsample(int output, float* out, int numSamples) {
+    auto& [stages, buffer] = mOutputs[output];
+    float* buf = buffer.data();
+    numSamples *= mFactor;
+    for (size_t i = 0; i < stages.size(); i++) {
+        numSamples /= 2;
+        // the last stage writes directly to the output
+        float* dst = i + 1 < stages.size() ? buf : out;
+        stages[i].process(buf, dst, numSamples);
+    }
+}
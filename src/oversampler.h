@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+
+/*! @class HalfbandUpsampler
+ *  @brief doubles the sample rate of a signal with a polyphase half-band FIR filter.
+ *
+ *  @discussion Every other coefficient of a half-band filter is zero, except for the
+ *  center tap. In the polyphase form, the even output samples are therefore just the
+ *  (delayed) input samples and only the odd output samples have to be filtered.
+ *  The filter introduces a delay of HalfbandUpsampler::kLatency input samples.
+ */
+class HalfbandUpsampler {
+public:
+    static constexpr int kLatency = 12;
+
+    explicit HalfbandUpsampler(int maxNumSamples);
+
+    /*! @brief reads 'numSamples' input samples and writes '2 * numSamples' output samples.
+     *  'in' and 'out' may point to the same buffer.
+     */
+    void process(const float* in, float* out, int numSamples);
+
+private:
+    /*! @brief the history followed by the current input */
+    std::vector<float> mBuffer;
+};
+
+/*! @class HalfbandDownsampler
+ *  @brief halves the sample rate of a signal, see HalfbandUpsampler.
+ *  The filter introduces a delay of HalfbandDownsampler::kLatency output samples.
+ */
+class HalfbandDownsampler {
+public:
+    static constexpr double kLatency = 11.5;
+
+    explicit HalfbandDownsampler(int maxNumSamples);
+
+    /*! @brief reads '2 * numSamples' input samples and writes 'numSamples' output samples.
+     *  'in' and 'out' may point to the same buffer.
+     */
+    void process(const float* in, float* out, int numSamples);
+
+private:
+    std::vector<float> mBuffer;
+};
+
+/*! @class Oversampler
+ *  @brief up- and downsamples the inputs resp. outputs of a DynGen instance
+ *  by a factor of 2, 4 or 8, see DynGenScript::mOversample.
+ *  The signals are resampled in several stages of 2x up- and downsampling.
+ *  All memory is allocated in the constructor.
+ */
+class Oversampler {
+public:
+    Oversampler(int factor, int numInputs, int numOutputs, int maxNumSamples);
+
+    int factor() const { return mFactor; }
+
+    /*! @brief upsamples 'numSamples' samples of the given input and returns the
+     *  oversampled signal. The buffer is valid until the input is upsampled again.
+     */
+    float* upsample(int input, const float* in, int numSamples);
+
+    /*! @brief like upsample(), but simply repeats every sample (zero-order hold).
+     *  This is used for signals that must not be filtered, e.g. triggers.
+     */
+    float* hold(int input, const float* in, int numSamples);
+
+    /*! @brief returns the buffer for the oversampled signal of the given output */
+    float* outputBuffer(int output) { return mOutputs[output].buffer.data(); }
+
+    /*! @brief downsamples the output buffer of the given output and writes 'numSamples'
+     *  samples to 'out'.
+     */
+    void downsample(int output, float* out, int numSamples);
+
+private:
+    struct Input {
+        std::vector<HalfbandUpsampler> stages;
+        std::vector<float> buffer;
+    };
+
+    struct Output {
+        std::vector<HalfbandDownsampler> stages;
+        std::vector<float> buffer;
+    };
+
+    int mFactor;
+    std::vector<Input> mInputs;
+    std::vector<Output> mOutputs;
+};
@@ -0,0 +1,335 @@
+#include "script_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+
+//-------------------- helper functions -------------------//
+
+namespace {
+
+enum class TokenType { Identifier, Punctuation, Other };
+
+struct Token {
+    TokenType type;
+    std::string_view text;
+    size_t pos;
+};
+
+bool isIdentifierStart(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '#'; }
+
+bool isIdentifierChar(char c) {
+    return isIdentifierStart(c) || std::isdigit(static_cast<unsigned char>(c)) || c == '.';
+}
+
+/*! @brief EEL2 variable names are case insensitive */
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*! @brief splits EEL2 code into identifiers and single punctuation characters.
+ *  Whitespace and comments are skipped; numbers, strings and character
+ *  constants (e.g. $pi or 'abc') are returned as TokenType::Other.
+ */
+std::vector<Token> tokenize(std::string_view code) {
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    auto size = code.size();
+    while (pos < size) {
+        auto c = code[pos];
+        auto start = pos;
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pos++;
+        } else if (code.compare(pos, 2, "//") == 0) {
+            // line comment
+            pos = code.find('\n', pos);
+            if (pos == std::string_view::npos) {
+                pos = size;
+            }
+        } else if (code.compare(pos, 2, "/*") == 0) {
+            // block comment
+            pos = code.find("*/", pos + 2);
+            pos = pos == std::string_view::npos ? size : pos + 2;
+        } else if (c == '"' || c == '\'') {
+            // string or character constant
+            pos++;
+            while (pos < size && code[pos] != c) {
+                // skip escaped characters
+                pos += code[pos] == '\\' ? 2 : 1;
+            }
+            pos = std::min(pos + 1, size);
+            tokens.push_back({ TokenType::Other, code.substr(start, pos - start), start });
+        } else if (c == '$') {
+            // named constant, e.g. $pi, $x1F or $'a'
+            pos++;
+            if (pos < size && code[pos] == '\'') {
+                pos = code.find('\'', pos + 1);
+                pos = pos == std::string_view::npos ? size : pos + 1;
+            } else {
+                while (pos < size && isIdentifierChar(code[pos])) {
+                    pos++;
+                }
+            }
+            tokens.push_back({ TokenType::Other, code.substr(start, pos - start), start });
+        } else if (std::isdigit(static_cast<unsigned char>(c))
+                   || (c == '.' && pos + 1 < size && std::isdigit(static_cast<unsigned char>(code[pos + 1])))) {
+            // number, including hex numbers and exponents
+            while (pos < size) {
+                auto d = code[pos];
+                if (std::isalnum(static_cast<unsigned char>(d)) || d == '.') {
+                    pos++;
+                } else if ((d == '-' || d == '+') && (code[pos - 1] == 'e' || code[pos - 1] == 'E')) {
+                    pos++;
+                } else {
+                    break;
+                }
+            }
+            tokens.push_back({ TokenType::Other, code.substr(start, pos - start), start });
+        } else if (isIdentifierStart(c)) {
+            while (pos < size && isIdentifierChar(code[pos])) {
+                pos++;
+            }
+            tokens.push_back({ TokenType::Identifier, code.substr(start, pos - start), start });
+        } else {
+            pos++;
+            tokens.push_back({ TokenType::Punctuation, code.substr(start, 1), start });
+        }
+    }
+    return tokens;
+}
+
+bool isPunctuation(const std::vector<Token>& tokens, size_t index, char c) {
+    return index < tokens.size() && tokens[index].type == TokenType::Punctuation && tokens[index].text[0] == c;
+}
+
+/*! @brief checks if the identifier at the given index is (potentially) written or used as a memory offset */
+bool isWritten(const std::vector<Token>& tokens, size_t index) {
+    auto next = index + 1;
+    if (isPunctuation(tokens, next, '=')) {
+        // '=' but not '=='
+        return !isPunctuation(tokens, next + 1, '=');
+    }
+    for (auto op : { '+', '-', '*', '/', '%', '|', '&', '^' }) {
+        // compound assignment, e.g. '+='
+        if (isPunctuation(tokens, next, op) && isPunctuation(tokens, next + 1, '=')
+            && !isPunctuation(tokens, next + 2, '=')) {
+            return true;
+        }
+    }
+    // memory offset, e.g. 'srate[0]'
+    return isPunctuation(tokens, next, '[');
+}
+
+bool isSimpleAssignment(const std::vector<Token>& tokens, size_t index) {
+    // '=' but not '=='
+    return isPunctuation(tokens, index + 1, '=') && !isPunctuation(tokens, index + 2, '=');
+}
+
+/*! @brief checks for output variables, i.e. out0, out1, etc. */
+bool isOutputVariable(std::string_view name) {
+    if (name.size() <= 3 || !equalsIgnoreCase(name.substr(0, 3), "out")) {
+        return false;
+    }
+    auto isDigit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+    return std::all_of(name.begin() + 3, name.end(), isDigit);
+}
+
+/*! @brief builtin functions without side effects or internal state */
+bool isPureFunction(std::string_view name) {
+    static const char* functions[] = {
+        "sin", "cos", "tan", "asin", "acos", "atan", "atan2", "sqr",
+        "sqrt", "pow", "exp", "log", "log10", "abs", "min", "max",
+        "sign", "floor", "ceil", "invsqrt", "clip", "wrap", "fold", "mod",
+        "lin", "cubic", "in", "out", "fsin", "fcos", "fexp2", "flog2",
+        "ftanh", "fsoftclip"
+    };
+    for (auto function : functions) {
+        if (equalsIgnoreCase(name, function)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+//-------------------- ConstantInliner -------------------//
+
+void ConstantInliner::add(std::string name, double value) {
+    std::array<char, 32> buffer;
+    auto [ptr, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    if (ec == std::errc()) {
+        mConstants.push_back({ std::move(name), std::string(buffer.data(), ptr), true });
+    }
+}
+
+const ConstantInliner::Constant* ConstantInliner::find(std::string_view name) const {
+    for (auto& constant : mConstants) {
+        if (constant.inlined && equalsIgnoreCase(constant.name, name)) {
+            return &constant;
+        }
+    }
+    return nullptr;
+}
+
+void ConstantInliner::analyze(std::string_view code) {
+    auto tokens = tokenize(code);
+    // nesting level of a declaration list, e.g. 'function foo(a, b)' or 'local(x, y)'
+    int declarationDepth = 0;
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        auto& token = tokens[i];
+        if (declarationDepth > 0) {
+            if (isPunctuation(tokens, i, '(')) {
+                declarationDepth++;
+            } else if (isPunctuation(tokens, i, ')')) {
+                declarationDepth--;
+            }
+        }
+        if (token.type != TokenType::Identifier) {
+            continue;
+        }
+
+        if (equalsIgnoreCase(token.text, "function")) {
+            // skip the function name
+            auto isName = i + 1 < tokens.size() && tokens[i + 1].type == TokenType::Identifier;
+            if (isName && isPunctuation(tokens, i + 2, '(')) {
+                declarationDepth++;
+                i += 2;
+            }
+            continue;
+        }
+        if (isPunctuation(tokens, i + 1, '(')
+            && (equalsIgnoreCase(token.text, "local") || equalsIgnoreCase(token.text, "instance")
+                || equalsIgnoreCase(token.text, "static") || equalsIgnoreCase(token.text, "global")
+                || equalsIgnoreCase(token.text, "globals"))) {
+            declarationDepth++;
+            i += 1;
+            continue;
+        }
+
+        for (auto& constant : mConstants) {
+            if (constant.inlined && equalsIgnoreCase(constant.name, token.text)
+                && (declarationDepth > 0 || isWritten(tokens, i))) {
+                constant.inlined = false;
+            }
+        }
+    }
+}
+
+std::string ConstantInliner::apply(std::string_view code) const {
+    std::string result;
+    result.reserve(code.size());
+    size_t pos = 0;
+    for (auto& token : tokenize(code)) {
+        if (token.type == TokenType::Identifier) {
+            if (auto constant = find(token.text)) {
+                result.append(code.substr(pos, token.pos - pos));
+                result.append(constant->literal);
+                pos = token.pos + token.text.size();
+            }
+        }
+    }
+    result.append(code.substr(pos));
+    return result;
+}
+
+//-------------------- isStatelessSection -------------------//
+
+bool isStatelessSection(std::string_view code) {
+    auto tokens = tokenize(code);
+
+    // 1. collect all variables which are written by the section
+    std::vector<std::string_view> written;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        auto& token = tokens[i];
+        if (token.type == TokenType::Identifier && isWritten(tokens, i)) {
+            written.push_back(token.text);
+        }
+    }
+    auto isWrittenVariable = [&](std::string_view name) {
+        return std::any_of(written.begin(), written.end(), [&](auto& w) { return equalsIgnoreCase(w, name); });
+    };
+
+    // 2. every variable which is written by the section must be assigned before it is read.
+    // Assignments only take effect at the end of a statement, so that 'x = x + 1' is detected.
+    // Assignments in the branches of a conditional do not count because they might be skipped.
+    std::vector<std::string_view> assigned;
+    std::vector<std::string_view> pending;
+    int depth = 0;
+    bool conditional = false;
+    auto assign = [&](std::string_view name) {
+        if (!conditional) {
+            pending.push_back(name);
+        }
+    };
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        auto& token = tokens[i];
+        if (token.type == TokenType::Punctuation) {
+            auto c = token.text[0];
+            if (c == '[') {
+                // memory access
+                return false;
+            } else if (c == '(') {
+                depth++;
+            } else if (c == ')') {
+                depth--;
+            } else if (c == '?') {
+                conditional = true;
+            } else if (c == ';') {
+                assigned.insert(assigned.end(), pending.begin(), pending.end());
+                pending.clear();
+                if (depth <= 0) {
+                    conditional = false;
+                }
+            }
+        } else if (token.type == TokenType::Other) {
+            if (token.text[0] == '"' || token.text[0] == '\'') {
+                // strings
+                return false;
+            }
+        } else {
+            auto name = token.text;
+            if (isPunctuation(tokens, i + 1, '(')) {
+                if (!isPureFunction(name)) {
+                    // user function, impure builtin function or keyword (e.g. 'loop' or 'local')
+                    return false;
+                }
+                continue;
+            }
+            if (name[0] == '#' || equalsIgnoreCase(name, "sampleNum")) {
+                return false;
+            }
+            if (isOutputVariable(name)) {
+                // output variables are cleared after every sample
+                if (isSimpleAssignment(tokens, i)) {
+                    assign(name);
+                }
+                continue;
+            }
+            if (!isWrittenVariable(name)) {
+                // only read by this section, e.g. an input, a parameter or a
+                // variable which has been set in the @init or @block section.
+                continue;
+            }
+            auto isAssigned =
+                std::any_of(assigned.begin(), assigned.end(), [&](auto& a) { return equalsIgnoreCase(a, name); });
+            if (isSimpleAssignment(tokens, i)) {
+                assign(name);
+            } else if (!isAssigned) {
+                // read before it has been assigned, or compound assignment
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*! @class ConstantInliner
+ *  @brief Replaces read-only variables with known values (e.g. 'srate') by number
+ *  literals in the script code, so that the EEL2 compiler can fold constant
+ *  subexpressions like '2 * $pi / srate'.
+ *
+ *  @discussion The script is not actually parsed, we only tokenize it.
+ *  This is sufficient because a variable is only inlined if *all* code sections
+ *  only ever read it: If a variable is assigned anywhere, declared as a function
+ *  parameter or local/instance/static variable, or used as a memory offset
+ *  (e.g. 'srate[0]'), it is left untouched.
+ */
+class ConstantInliner {
+public:
+    /*! @brief add a variable with a known value */
+    void add(std::string name, double value);
+
+    /*! @brief analyze a code section; variables which might be written are removed.
+     *  All code sections must be analyzed before calling apply()!
+     */
+    void analyze(std::string_view code);
+
+    /*! @brief returns the given code section with all remaining variables inlined */
+    std::string apply(std::string_view code) const;
+
+private:
+    struct Constant {
+        std::string name;
+        std::string literal;
+        bool inlined = true;
+    };
+
+    const Constant* find(std::string_view name) const;
+
+    std::vector<Constant> mConstants;
+};
+
+/*! @brief checks if the given @sample section is stateless, i.e. if its output
+ *  only depends on the current inputs and parameters and on variables which are
+ *  not written by the section itself. In this case the section will always produce
+ *  the same result for the same input values, see EEL2Adapter::process().
+ *
+ *  @discussion The analysis is very conservative: any loop, memory access, string,
+ *  user function call or impure builtin function (e.g. rand() or poll()) makes
+ *  the section stateful. Conditionals are allowed, but assignments in their branches
+ *  do not count because they might be skipped, e.g. 'x > 0 ? (y = x); out0 = y;'
+ *  is stateful because 'y' keeps its value from the previous sample.
+ */
+bool isStatelessSection(std::string_view code);
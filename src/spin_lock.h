@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// The following is adapted from SC_SndBuf.h
+// NOTE: do not include <windows.h> because of the IN and OUT macros!
+#if defined(_MSC_VER) && defined(_M_ARM64) // Visual Studio ARM64
+#    include <intrin.h>
+inline void pauseCpu() { __yield(); }
+#elif defined(_MSC_VER) // Visual Studio Intel
+#    include <intrin.h>
+inline void pauseCpu() { _mm_pause(); }
+#elif defined(__SSE2__) // all modern Intel processors
+#    include <immintrin.h>
+inline void pauseCpu() { _mm_pause(); }
+#elif defined(__aarch64__) // 64-bit ARM
+inline void pauseCpu() { __asm__ __volatile__("isb"); }
+#elif defined(__arm__) // 32-bit ARM
+inline void pauseCpu() { __asm__ __volatile__("yield"); }
+#else
+#    warning "unknown architecture: fall back to busy-waiting"
+inline void pauseCpu() {}
+#endif
+
+/*! @class SpinLock
+ *  @brief A simple spin lock which is safe to use on the audio thread(s).
+ *
+ *  @discussion The lock is aligned to a cache line so that it does not share
+ *  a cache line with other data. Otherwise every write to neighboring variables
+ *  would invalidate the lock in the caches of all other (Supernova) DSP threads.
+ */
+class alignas(64) SpinLock {
+public:
+    void lock() {
+        // optimize for non-contended case
+        while (mLocked.exchange(1, std::memory_order_acquire) != 0) {
+            // only read while waiting so that we do not steal the cache line from the owner
+            while (mLocked.load(std::memory_order_relaxed) != 0) {
+                pauseCpu();
+            }
+        }
+    }
+
+    void unlock() { mLocked.store(0, std::memory_order_release); }
+
+private:
+    std::atomic<uint32_t> mLocked { 0 };
+};
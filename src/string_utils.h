@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cctype>
+#include <cstdint>
 #include <string_view>
 
 /*! @brief check if the given character is considered whitespace.
@@ -115,3 +116,25 @@ inline std::string_view trim(std::string_view string) {
         return {};
     }
 }
+
+/*! @brief computes the 64 bit FNV-1a hash of the given string.
+ *  Pass the result of a previous call as 'hash' to hash several strings in a row.
+ */
+inline uint64_t hashString(std::string_view string, uint64_t hash = 14695981039346656037ULL) {
+    for (auto& c : string) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*! @brief computes the Adler-32 checksum of the given string */
+inline uint32_t adler32(std::string_view string) {
+    constexpr uint32_t modulus = 65521;
+    uint32_t a = 1, b = 0;
+    for (auto& c : string) {
+        a = (a + static_cast<unsigned char>(c)) % modulus;
+        b = (b + a) % modulus;
+    }
+    return (b << 16) | a;
+}
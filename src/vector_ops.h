@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+/*! @file vector_ops.h
+ *  @brief vector kernels for the memory functions of DynGen scripts, see EEL2Adapter::setup().
+ *
+ *  @discussion The kernels are plain loops over contiguous arrays, which the compiler can
+ *  vectorize (e.g. SSE2 on x86_64, NEON on arm64, or wider with -march=native).
+ *  Reductions use several independent accumulators, because the compiler is not allowed
+ *  to reorder floating point additions on its own.
+ *  All element-wise kernels may operate in place, i.e. 'dst' may be the same as 'src'.
+ */
+namespace vecops {
+
+/*! @brief dst = a + b */
+inline void add(double* dst, const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = a[i] + b[i];
+    }
+}
+
+/*! @brief dst = a * b */
+inline void mul(double* dst, const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = a[i] * b[i];
+    }
+}
+
+/*! @brief dst += a * b */
+inline void mac(double* dst, const double* a, const double* b, int n) {
+    for (int i = 0; i < n; i++) {
+        dst[i] += a[i] * b[i];
+    }
+}
+
+/*! @brief dst = src * mul + add */
+inline void scale(double* dst, const double* src, int n, double mul, double add) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = src[i] * mul + add;
+    }
+}
+
+/*! @brief dst = clip(src, lo, hi) */
+inline void clip(double* dst, const double* src, int n, double lo, double hi) {
+    for (int i = 0; i < n; i++) {
+        dst[i] = std::min(std::max(src[i], lo), hi);
+    }
+}
+
+inline double min(const double* src, int n) {
+    double m[4] = { src[0], src[0], src[0], src[0] };
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            m[k] = std::min(m[k], src[i + k]);
+        }
+    }
+    for (; i < n; i++) {
+        m[0] = std::min(m[0], src[i]);
+    }
+    return std::min(std::min(m[0], m[1]), std::min(m[2], m[3]));
+}
+
+inline double max(const double* src, int n) {
+    double m[4] = { src[0], src[0], src[0], src[0] };
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            m[k] = std::max(m[k], src[i + k]);
+        }
+    }
+    for (; i < n; i++) {
+        m[0] = std::max(m[0], src[i]);
+    }
+    return std::max(std::max(m[0], m[1]), std::max(m[2], m[3]));
+}
+
+/*! @brief returns the max. absolute value */
+inline double peak(const double* src, int n) {
+    double m[4] = { 0.0, 0.0, 0.0, 0.0 };
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            m[k] = std::max(m[k], std::abs(src[i + k]));
+        }
+    }
+    for (; i < n; i++) {
+        m[0] = std::max(m[0], std::abs(src[i]));
+    }
+    return std::max(std::max(m[0], m[1]), std::max(m[2], m[3]));
+}
+
+/*! @brief returns the sum of a[i] * b[i] */
+inline double dot(const double* a, const double* b, int n) {
+    double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            sum[k] += a[i + k] * b[i + k];
+        }
+    }
+    for (; i < n; i++) {
+        sum[0] += a[i] * b[i];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+} // namespace vecops
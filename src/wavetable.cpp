@@ -0,0 +1,186 @@
+#include "wavetable.h"
+#include "fast_math.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <vector>
+
+//-------------------- helper functions -------------------//
+
+namespace {
+
+using Complex = std::complex<double>;
+
+/*! @brief in-place radix-2 FFT; the size must be a power of two.
+ *  The inverse transform is not normalized.
+ */
+void fft(std::vector<Complex>& x, bool inverse) {
+    const auto n = x.size();
+    // bit reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        auto bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(x[i], x[j]);
+        }
+    }
+    // butterflies
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = 2.0 * fastmath::kPi / static_cast<double>(len) * (inverse ? 1.0 : -1.0);
+        Complex w(std::cos(angle), std::sin(angle));
+        for (size_t i = 0; i < n; i += len) {
+            Complex wk(1.0, 0.0);
+            for (size_t k = 0; k < len / 2; k++) {
+                auto u = x[i + k];
+                auto v = x[i + k + len / 2] * wk;
+                x[i + k] = u + v;
+                x[i + k + len / 2] = u - v;
+                wk *= w;
+            }
+        }
+    }
+}
+
+int log2Int(int n) {
+    int result = 0;
+    while (n > 1) {
+        n >>= 1;
+        result++;
+    }
+    return result;
+}
+
+// RT owned
+Wavetable* gWavetables = nullptr;
+uint32_t gWavetableGeneration = 0;
+
+} // namespace
+
+//-------------------- Wavetable -------------------//
+
+Wavetable::Wavetable(int bufNum, const float* data, int frames, int channels):
+    mBufNum(bufNum), mSize(frames), mNumLevels(log2Int(frames)), mSource(data),
+    mChecksum(checksum(data, frames, channels)) {
+    assert(frames >= 4 && (frames & (frames - 1)) == 0);
+
+    std::vector<Complex> spectrum(mSize);
+    for (int i = 0; i < mSize; i++) {
+        spectrum[i] = data[i * channels];
+    }
+    fft(spectrum, false);
+
+    mData = std::make_unique<float[]>(static_cast<size_t>(mNumLevels) * (mSize + 1));
+    std::vector<Complex> level(mSize);
+    for (int k = 0; k < mNumLevels; k++) {
+        // remove all harmonics above N / 2^(k+1); the first level also drops the Nyquist bin.
+        int maxHarmonic = std::min(mSize >> (k + 1), mSize / 2 - 1);
+        level = spectrum;
+        std::fill(level.begin() + maxHarmonic + 1, level.end() - maxHarmonic, Complex(0.0, 0.0));
+        fft(level, true);
+
+        float* dest = &mData[static_cast<size_t>(k) * (mSize + 1)];
+        for (int i = 0; i < mSize; i++) {
+            dest[i] = static_cast<float>(level[i].real() / mSize);
+        }
+        dest[mSize] = dest[0]; // guard point
+    }
+}
+
+uint64_t Wavetable::checksum(const float* data, int frames, int channels) {
+    // 64 frames are enough to detect a new waveform, but cheap enough to check once per block.
+    constexpr int kNumFrames = 64;
+    const int step = std::max(frames / kNumFrames, 1);
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    for (int i = 0; i < frames; i += step) {
+        uint32_t bits;
+        std::memcpy(&bits, &data[static_cast<size_t>(i) * channels], sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+double Wavetable::read(double phase, double increment) const {
+    if (!std::isfinite(phase)) {
+        return 0.0;
+    }
+    // Level k is free of aliasing if N / 2^(k+1) <= 0.5 / increment, i.e. k >= log2(N * increment).
+    // We crossfade from level floor(level) + 1 to the next higher level, so that both levels are
+    // at least ceil(level) and the result is still continuous at integer levels.
+    double level = fastmath::log2(std::abs(increment) * mSize);
+    if (!(level > -1.0)) {
+        // also catches -inf (zero increment) and NaN
+        level = -1.0;
+    } else if (level > mNumLevels) {
+        level = mNumLevels;
+    }
+    double levelFloor = std::floor(level);
+    int level1 = static_cast<int>(levelFloor) + 1;
+    double levelFrac = level - levelFloor;
+    if (level1 >= mNumLevels - 1) {
+        level1 = mNumLevels - 1;
+        levelFrac = 0.0;
+    }
+    int level2 = std::min(level1 + 1, mNumLevels - 1);
+
+    double pos = (phase - std::floor(phase)) * mSize;
+    int index = std::min(static_cast<int>(pos), mSize - 1);
+    double frac = pos - index;
+
+    auto readLevel = [&](int k) {
+        const float* table = &mData[static_cast<size_t>(k) * (mSize + 1)];
+        double a = table[index];
+        double b = table[index + 1];
+        return a + frac * (b - a);
+    };
+    double a = readLevel(level1);
+    if (levelFrac > 0.0) {
+        double b = readLevel(level2);
+        return a + levelFrac * (b - a);
+    } else {
+        return a;
+    }
+}
+
+//-------------------- registry -------------------//
+
+const Wavetable* findWavetable(int bufNum) {
+    for (auto table = gWavetables; table != nullptr; table = table->mNext) {
+        if (table->bufNum() == bufNum) {
+            return table;
+        }
+    }
+    return nullptr;
+}
+
+Wavetable* installWavetable(Wavetable* table) {
+    gWavetableGeneration++;
+    // replace existing table
+    for (Wavetable** it = &gWavetables; *it != nullptr; it = &(*it)->mNext) {
+        if ((*it)->bufNum() == table->bufNum()) {
+            auto old = *it;
+            table->mNext = old->mNext;
+            *it = table;
+            return old;
+        }
+    }
+    // prepend new table
+    table->mNext = gWavetables;
+    gWavetables = table;
+    return nullptr;
+}
+
+uint32_t wavetableGeneration() { return gWavetableGeneration; }
+
+void freeAllWavetables() {
+    while (gWavetables != nullptr) {
+        auto next = gWavetables->mNext;
+        delete gWavetables;
+        gWavetables = next;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+/*! @class Wavetable
+ *  @brief a band-limited mipmap set of a single-cycle waveform.
+ *
+ *  @discussion Level k only contains the harmonics up to N / 2^(k+1), where N is the
+ *  (power-of-two) table size. The levels are built from the spectrum of the waveform
+ *  with a FFT, so they are perfectly band-limited. When reading the table, read() picks
+ *  the lowest level without aliasing from the phase increment and crossfades towards
+ *  the next higher level, so that the number of harmonics changes smoothly with the pitch.
+ *
+ *  Wavetables are built on the NRT thread and are immutable afterwards. The RT thread
+ *  keeps a registry of all wavetables, see findWavetable() and installWavetable().
+ */
+class Wavetable {
+public:
+    /*! @brief builds the mipmap set from the first channel of the given sound buffer data.
+     *  'frames' must be a power of two and at least 4. Not RT safe!
+     */
+    Wavetable(int bufNum, const float* data, int frames, int channels);
+
+    int bufNum() const { return mBufNum; }
+
+    int size() const { return mSize; }
+
+    /*! @brief checks if the wavetable has been built from the current data of the buffer.
+     *  The buffer data is reallocated when the buffer is (re)allocated or (re)read; in-place
+     *  changes (e.g. b_gen) and reallocations at the same address are detected with checksum().
+     */
+    bool matches(const float* data, int frames, int channels) const {
+        return data == mSource && frames == mSize && checksum(data, frames, channels) == mChecksum;
+    }
+
+    /*! @brief a cheap checksum of the first channel which only looks at a few evenly spaced frames.
+     *  NOTE: changing only a few samples (e.g. with b_set) might not be detected!
+     */
+    static uint64_t checksum(const float* data, int frames, int channels);
+
+    /*! @brief reads the table at the given phase (in cycles) with linear interpolation.
+     *  'increment' is the phase increment per sample and determines the mip level.
+     */
+    double read(double phase, double increment) const;
+
+    /*! @brief the next wavetable in the registry, see installWavetable() */
+    Wavetable* mNext = nullptr;
+
+private:
+    int mBufNum;
+    int mSize;
+    int mNumLevels;
+    /*! @brief only used for comparison, see matches() */
+    const float* mSource;
+    uint64_t mChecksum;
+    /*! @brief all levels, one after the other. Every level has an additional
+     *  guard point at the end to simplify the interpolation.
+     */
+    std::unique_ptr<float[]> mData;
+};
+
+/*! @brief returns the wavetable for the given buffer number, or NULL. RT only! */
+const Wavetable* findWavetable(int bufNum);
+
+/*! @brief adds the wavetable to the registry and returns the previous wavetable
+ *  for the same buffer number (or NULL), which must be freed on the NRT thread. RT only!
+ */
+Wavetable* installWavetable(Wavetable* table);
+
+/*! @brief incremented by installWavetable(), so that cached wavetable pointers
+ *  can be invalidated. RT only!
+ */
+uint32_t wavetableGeneration();
+
+/*! @brief frees all wavetables; only called when the plugin is unloaded */
+void freeAllWavetables();